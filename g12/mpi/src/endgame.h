@@ -0,0 +1,46 @@
+/*
+    Exact endgame. Once at most k cities are left, a node is finished off by a depth-first search
+    over the remaining cities (a 64-bit mask, so instances of up to 64 cities only) instead of being
+    expanded one level at a time through the queue. The search prunes on the same half-sum bound as
+    the main one, and remembers the cost of closing the tour from every (remaining set, current city)
+    it solves, exactly or as a lower bound, in a fixed-size table shared by all the nodes it is given.
+
+    Every completion that ties for the cheapest is handed back, built the way the main search would
+    have built it, and the main search weighs them as it does the tours it completes itself.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "node.h"
+#include "repr.h"
+
+typedef struct tsp_endgame tsp_endgame;
+
+typedef struct
+{
+    unsigned long solved;
+    // Solves that came up with completions within their limit
+    unsigned long completed;
+    unsigned long lookups;
+    unsigned long hits;
+} tsp_endgame_stats;
+
+// Scratch space for one thread, taking over with at most k cities left.
+// Returns NULL (and warns) when the instance is too large for it.
+tsp_endgame *tsp_endgame_create(tsp_repr rep, unsigned int k);
+void tsp_endgame_delete(tsp_endgame *endgame);
+
+// Whether node is close enough to the end to be solved
+bool tsp_endgame_covers(const tsp_endgame *endgame, const tsp_node *node);
+
+// Work out the cheapest completions of node with a tour cost of at most limit (or a rounding error
+// over it), and return how many there are (several only when they tie). base is the half-sum bound of node.
+unsigned int tsp_endgame_solve(tsp_endgame *endgame, tsp_node *node, double base, double limit);
+
+// The completions from the last solve, one at a time as complete nodes (their bound set to the tour
+// cost), then NULL
+tsp_node *tsp_endgame_next(tsp_endgame *endgame);
+
+tsp_endgame_stats tsp_endgame_stats_of(const tsp_endgame *endgame);
@@ -0,0 +1,59 @@
+/*
+    Tour-reversal symmetry breaking. Edges are always written both ways, so every tour costs the
+    same as its mirror image. With --symmetry=break the search only builds tours whose second city
+    is below their last one, and every tour it finds is weighed in whichever direction the full
+    search would have preferred, so the tour reported stays the same.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "node.h"
+#include "repr.h"
+
+// How the full (half-sum) search would see the complete node for a tour in one direction
+typedef struct
+{
+    double cost;
+    double bound;
+    unsigned int index;
+} tsp_mirror_key;
+
+// Keep only the children of node (cities[0...found-1] and their bounds) that can still end on a
+// city above the tour's second one. Returns how many are left.
+unsigned int tsp_mirror_filter(const tsp_node *node, unsigned int ncities, unsigned int *cities, double *bounds, unsigned int found);
+
+// The key of tour, or of its mirror image when reversed is set. Its index is the last city as the
+// input numbered it, so that tours found on renumbered cities (see relabel.h) weigh the same.
+tsp_mirror_key tsp_mirror_key_of(tsp_repr rep, double lowerbound, const unsigned int *tour, bool reversed);
+
+// Reverse tour[1...ncities-1] in place
+void tsp_mirror_reverse(unsigned int *tour, unsigned int ncities);
+
+/*
+    The tours, in both directions, that cost about as little as the cheapest one offered so far
+    (and less than upper, where the full search starts from). Tours that only cost the same once
+    rounded are all kept: the full search meets them in the order of their keys, and takes one over
+    the tour before only if it is cheaper and not cut off by that tour's cost. Which one that leaves
+    is only worked out once every tour is in, so the order they come in does not matter.
+*/
+typedef struct tsp_mirror_pool tsp_mirror_pool;
+
+tsp_mirror_pool *tsp_mirror_pool_create(tsp_repr rep, double lowerbound, double upper);
+void tsp_mirror_pool_delete(tsp_mirror_pool *pool);
+
+// Weigh both directions of tour, leaving out those the full search would have cut on limit.
+// Returns the bound above which the search can drop a node: nothing under it costs less.
+double tsp_mirror_offer(tsp_mirror_pool *pool, const unsigned int *tour, double limit);
+
+// Keep tour under key as it is, as weighed by another process
+void tsp_mirror_add(tsp_mirror_pool *pool, tsp_mirror_key key, const unsigned int *tour);
+
+size_t tsp_mirror_count(const tsp_mirror_pool *pool);
+tsp_mirror_key tsp_mirror_key_at(const tsp_mirror_pool *pool, size_t i);
+const unsigned int *tsp_mirror_tour_at(const tsp_mirror_pool *pool, size_t i);
+
+// The tour the full search would have reported, copied into tour[0...ncities-1], and its key, or a
+// key of infinite cost (and tour left alone) when it would not have reported any
+tsp_mirror_key tsp_mirror_pick(tsp_mirror_pool *pool, unsigned int *tour);
@@ -0,0 +1,66 @@
+/*
+    Optional settings, given as --key=value after the input file and the lowerbound.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// Past this many cities, finishing a node off in one go takes longer than searching it
+#define TSP_ENDGAME_MAX 16
+
+// Defaults for --scheduler=tasks
+#define TSP_TASK_DEPTH 6
+#define TSP_TASK_GRAIN 4096
+
+typedef enum
+{
+    // Half the sum of the two cheapest edges at every city
+    TSP_BOUND_HALFSUM,
+    // Lagrangian 1-tree (Held-Karp), see bound.h
+    TSP_BOUND_ONETREE,
+} tsp_bound_kind;
+
+typedef enum
+{
+    // Per-thread queues, with work stolen through deques
+    TSP_SCHEDULER_STEAL,
+    // Several heaps per thread shared by all, popping the better top of two at random
+    TSP_SCHEDULER_MULTIQUEUE,
+    // Best-first near the root, then depth-first subtrees as OpenMP tasks
+    TSP_SCHEDULER_TASKS,
+} tsp_scheduler_kind;
+
+typedef struct
+{
+    tsp_bound_kind bound;
+    // Only search one direction of every tour (see mirror.h)
+    bool symmetry;
+    // MiB for the dominance table, 0 to go without (see dominance.h)
+    size_t dominance;
+    // Cities left at which a node is finished off exactly, 0 to go without (see endgame.h)
+    unsigned int endgame;
+    // Drop nodes that can no longer be closed into a tour (see feasible.h)
+    bool feasibility;
+    // Take edges no good tour can use out of the graph before searching (see reduce.h)
+    bool reduce;
+    // Renumber the cities before searching (see relabel.h)
+    bool relabel;
+    // How tsp-omp spreads nodes over its threads; the other solvers have a single queue per process
+    tsp_scheduler_kind scheduler;
+    // --scheduler=tasks: cities on the tour from which a node is searched as a task, and nodes a
+    // task expands before handing what it has left to new tasks (0 to never)
+    unsigned int task_depth;
+    unsigned long task_grain;
+    // Give every OpenMP place (a socket, with OMP_PLACES=sockets) its own copy of the instance and
+    // steal within the place first (tsp-omp only)
+    bool numa;
+} tsp_options;
+
+// Fill options from argv[first...argc-1], with defaults for whatever is not given. The options that
+// only spread the search over OpenMP threads are only understood with threads set (tsp-omp).
+// Returns NULL on success, or the argument that could not be understood.
+const char *tsp_options_parse(tsp_options *options, int argc, char *argv[], int first, bool threads);
+
+// Describe the options on stdout, for the usage message; threads as for tsp_options_parse
+void tsp_options_help(bool threads);
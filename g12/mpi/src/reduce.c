@@ -0,0 +1,475 @@
+#include "reduce.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "heuristic.h"
+#include "matrix.h"
+
+// An empty slot in the forced neighbours of a city
+#define NONE UINT_MAX
+
+// Subgradient steps for the penalties of the 1-tree, and the step size as in bound.c
+#define ASCENT_ITERATIONS 200
+#define STEP_START 2.0
+#define STEP_DECAY 0.97
+
+typedef struct
+{
+    unsigned int n;
+    double *graph;
+    // The (up to) two neighbours each city is known to be joined to on every tour left
+    unsigned int *forced;
+    unsigned int removed;
+    // The 1-tree: penalties, the parent of every city other than 0 in the spanning tree over them
+    // (city 1 is its root), how deep each sits, and the two cities 0 is joined to
+    double *pi;
+    unsigned int *parent;
+    unsigned int *depth;
+    int *degree;
+    unsigned int ends[2];
+} reduction;
+
+static unsigned int forced_count(const reduction *r, unsigned int v)
+{
+    return (r->forced[2 * v] != NONE) + (r->forced[2 * v + 1] != NONE);
+}
+
+static bool is_forced(const reduction *r, unsigned int v, unsigned int u)
+{
+    return r->forced[2 * v] == u || r->forced[2 * v + 1] == u;
+}
+
+// Record that the edge between v and u is on every tour left. Returns whether that is news.
+static bool force(reduction *r, unsigned int v, unsigned int u)
+{
+    if (is_forced(r, v, u) || forced_count(r, v) == 2 || forced_count(r, u) == 2)
+    {
+        // Either known, or a third edge at a city: then no tour is left at all, and the search finds as much
+        return false;
+    }
+    r->forced[2 * v + forced_count(r, v)] = u;
+    r->forced[2 * u + forced_count(r, u)] = v;
+    return true;
+}
+
+static void remove_edge(reduction *r, unsigned int v, unsigned int u)
+{
+    matrix_write(r->graph, r->n, v, u, INFINITY);
+    matrix_write(r->graph, r->n, u, v, INFINITY);
+    r->removed++;
+}
+
+// The cheapest edge at v other than the one to except (NONE for none), and the next cheapest
+static void cheapest(const reduction *r, unsigned int v, unsigned int except, double *first, double *second)
+{
+    *first = *second = INFINITY;
+    for (unsigned int u = 0; u < r->n; u++)
+    {
+        double edge = matrix_read(r->graph, r->n, v, u);
+        if (u == except || edge >= *second)
+        {
+            continue;
+        }
+        if (edge < *first)
+        {
+            *second = *first;
+            *first = edge;
+        }
+        else
+        {
+            *second = edge;
+        }
+    }
+}
+
+// Forced edges from cities down to two edges, and the edges they rule out. Returns whether anything changed.
+static bool propagate(reduction *r)
+{
+    const unsigned int n = r->n;
+    bool changed = false;
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        unsigned int degree = 0;
+        for (unsigned int u = 0; u < n; u++)
+        {
+            degree += matrix_read(r->graph, n, v, u) != INFINITY;
+        }
+        for (unsigned int u = 0; degree == 2 && u < n; u++)
+        {
+            if (matrix_read(r->graph, n, v, u) != INFINITY)
+            {
+                changed |= force(r, v, u);
+            }
+        }
+    }
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        // Both edges of v are known, so no other can be used
+        for (unsigned int u = 0; forced_count(r, v) == 2 && u < n; u++)
+        {
+            if (matrix_read(r->graph, n, v, u) != INFINITY && !is_forced(r, v, u))
+            {
+                remove_edge(r, v, u);
+                changed = true;
+            }
+        }
+
+        // v ends a chain of forced edges; an edge between its two ends would close a short cycle
+        if (forced_count(r, v) != 1)
+        {
+            continue;
+        }
+        unsigned int prev = v, here = r->forced[2 * v], length = 2;
+        while (forced_count(r, here) == 2)
+        {
+            unsigned int next = r->forced[2 * here] != prev ? r->forced[2 * here] : r->forced[2 * here + 1];
+            prev = here;
+            here = next;
+            length++;
+        }
+        if (length > 2 && length < n && matrix_read(r->graph, n, v, here) != INFINITY)
+        {
+            remove_edge(r, v, here);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// The cheapest pair of edges v can be left with when it uses the edge to u, given what is forced.
+// base is the cheapest pair with no such condition, as worked out by eliminate.
+static double pair_with(const reduction *r, unsigned int v, unsigned int u, double first, double second, double base)
+{
+    double edge = matrix_read(r->graph, r->n, v, u);
+    switch (forced_count(r, v))
+    {
+    case 2:
+        return base;
+    case 1:
+        return is_forced(r, v, u) ? base : matrix_read(r->graph, r->n, v, r->forced[2 * v]) + edge;
+    default:
+        return first + (edge > second ? edge : second);
+    }
+}
+
+// Take out the edges whose cheapest tour goes over cutoff. Returns whether any went.
+static bool eliminate(reduction *r, double cutoff)
+{
+    const unsigned int n = r->n;
+    double *first = malloc(n * sizeof(double));
+    double *second = malloc(n * sizeof(double));
+    double *base = malloc(n * sizeof(double));
+    double bound = 0;
+    bool changed = false;
+
+    // What every city contributes to the bound: its two cheapest edges, or the forced ones
+    for (unsigned int v = 0; v < n; v++)
+    {
+        cheapest(r, v, NONE, first + v, second + v);
+        base[v] = first[v] + second[v];
+        if (forced_count(r, v) == 2)
+        {
+            base[v] = matrix_read(r->graph, n, v, r->forced[2 * v]) + matrix_read(r->graph, n, v, r->forced[2 * v + 1]);
+        }
+        else if (forced_count(r, v) == 1)
+        {
+            unsigned int u = r->forced[2 * v];
+            double other, unused;
+            cheapest(r, v, u, &other, &unused);
+            base[v] = matrix_read(r->graph, n, v, u) + other;
+        }
+        bound += base[v];
+    }
+    bound /= 2;
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = i + 1; j < n; j++)
+        {
+            if (matrix_read(r->graph, n, i, j) == INFINITY)
+            {
+                continue;
+            }
+            double through = bound + (pair_with(r, i, j, first[i], second[i], base[i]) - base[i] +
+                                      pair_with(r, j, i, first[j], second[j], base[j]) - base[j]) / 2;
+            if (through > cutoff)
+            {
+                remove_edge(r, i, j);
+                changed = true;
+            }
+        }
+    }
+
+    free(first);
+    free(second);
+    free(base);
+    return changed;
+}
+
+// Weight of an edge under the penalties
+static double weight(const reduction *r, unsigned int v, unsigned int u)
+{
+    return matrix_read(r->graph, r->n, v, u) + r->pi[v] + r->pi[u];
+}
+
+// The penalized 1-tree: a spanning tree over cities 1...n-1 plus the two cheapest edges at 0.
+// Fills parent, depth, degree and ends, and returns its Lagrangian bound (INFINITY if there is none).
+static double onetree(reduction *r, double *key, bool *intree)
+{
+    const unsigned int n = r->n;
+    double total = 0;
+
+    // Prim's algorithm, dense; cities join the tree after their parent, so depth can follow along
+    for (unsigned int v = 1; v < n; v++)
+    {
+        key[v] = INFINITY;
+        intree[v] = false;
+        r->degree[v] = 0;
+    }
+    r->degree[0] = 0;
+    key[1] = 0;
+    r->parent[1] = NONE;
+    r->depth[1] = 0;
+    for (unsigned int added = 1; added < n; added++)
+    {
+        unsigned int next = NONE;
+        for (unsigned int v = 1; v < n; v++)
+        {
+            if (!intree[v] && (next == NONE || key[v] < key[next]))
+            {
+                next = v;
+            }
+        }
+        if (key[next] == INFINITY)
+        {
+            return INFINITY;
+        }
+
+        intree[next] = true;
+        total += key[next];
+        if (r->parent[next] != NONE)
+        {
+            r->depth[next] = r->depth[r->parent[next]] + 1;
+            r->degree[next]++;
+            r->degree[r->parent[next]]++;
+        }
+        for (unsigned int v = 1; v < n; v++)
+        {
+            double w;
+            if (!intree[v] && (w = weight(r, next, v)) < key[v])
+            {
+                key[v] = w;
+                r->parent[v] = next;
+            }
+        }
+    }
+
+    r->ends[0] = r->ends[1] = NONE;
+    for (unsigned int v = 1; v < n; v++)
+    {
+        double w = weight(r, 0, v);
+        if (r->ends[0] == NONE || w < weight(r, 0, r->ends[0]))
+        {
+            r->ends[1] = r->ends[0];
+            r->ends[0] = v;
+        }
+        else if (r->ends[1] == NONE || w < weight(r, 0, r->ends[1]))
+        {
+            r->ends[1] = v;
+        }
+    }
+    total += weight(r, 0, r->ends[0]) + weight(r, 0, r->ends[1]);
+    r->degree[0] = 2;
+    r->degree[r->ends[0]]++;
+    r->degree[r->ends[1]]++;
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        total -= 2 * r->pi[v];
+    }
+    return total;
+}
+
+// The heaviest penalized edge on the tree path between two cities other than 0
+static double path_max(const reduction *r, unsigned int v, unsigned int u)
+{
+    double heaviest = -INFINITY;
+    while (v != u)
+    {
+        if (r->depth[v] < r->depth[u])
+        {
+            unsigned int swap = v;
+            v = u;
+            u = swap;
+        }
+        double w = weight(r, v, r->parent[v]);
+        heaviest = w > heaviest ? w : heaviest;
+        v = r->parent[v];
+    }
+    return heaviest;
+}
+
+/*
+    Take out the edges that, swapped into the best 1-tree in place of the heaviest edge they would
+    close a cycle with, give a bound over cutoff. The penalties come from a subgradient ascent like
+    the one in bound.c, only over the whole graph. Returns whether any edge went.
+*/
+static bool eliminate_onetree(reduction *r, double cutoff)
+{
+    const unsigned int n = r->n;
+    double *key = malloc(n * sizeof(double));
+    bool *intree = malloc(n * sizeof(bool));
+    double *best_pi = calloc(n, sizeof(double));
+    double best = -INFINITY, step = STEP_START;
+    bool changed = false;
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        r->pi[v] = 0;
+    }
+    for (unsigned int it = 0; it < ASCENT_ITERATIONS; it++)
+    {
+        double bound = onetree(r, key, intree);
+        if (bound == INFINITY)
+        {
+            break;
+        }
+        if (bound > best)
+        {
+            best = bound;
+            for (unsigned int v = 0; v < n; v++)
+            {
+                best_pi[v] = r->pi[v];
+            }
+        }
+
+        double norm = 0;
+        for (unsigned int v = 0; v < n; v++)
+        {
+            norm += (r->degree[v] - 2) * (r->degree[v] - 2);
+        }
+        if (norm == 0 || best > cutoff)
+        {
+            break;
+        }
+        double t = step * (cutoff - bound) / norm;
+        for (unsigned int v = 0; v < n; v++)
+        {
+            r->pi[v] += t * (r->degree[v] - 2);
+        }
+        step *= STEP_DECAY;
+    }
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        r->pi[v] = best_pi[v];
+    }
+    double bound = best == -INFINITY ? INFINITY : onetree(r, key, intree);
+    for (unsigned int i = 0; bound != INFINITY && i < n; i++)
+    {
+        for (unsigned int j = i + 1; j < n; j++)
+        {
+            if (matrix_read(r->graph, n, i, j) == INFINITY || r->parent[j] == i || r->parent[i] == j)
+            {
+                continue;
+            }
+            double through;
+            if (i == 0)
+            {
+                if (j == r->ends[0] || j == r->ends[1])
+                {
+                    continue;
+                }
+                through = bound + weight(r, 0, j) - weight(r, 0, r->ends[1]);
+            }
+            else
+            {
+                through = bound + weight(r, i, j) - path_max(r, i, j);
+            }
+            if (through > cutoff)
+            {
+                remove_edge(r, i, j);
+                changed = true;
+            }
+        }
+    }
+
+    free(key);
+    free(intree);
+    free(best_pi);
+    return changed;
+}
+
+double tsp_reduce(tsp_repr *rep, double limit, double seed)
+{
+    const unsigned int n = rep->ncities;
+    double before = 0, after = 0;
+    for (unsigned int v = 0; v < n; v++)
+    {
+        before += rep->short1[v] + rep->short2[v];
+    }
+    before /= 2;
+
+    if (n < 4)
+    {
+        // Every edge is on the only tour there is
+        return before;
+    }
+
+    // Tours that cost as much as the heuristic one are kept, since they may be the one to print
+    double cutoff = (seed < limit ? seed : limit) + TSP_COST_STEP / 2;
+
+    reduction r = {.n = n, .graph = rep->graph, .forced = arrayi_alloc(2 * n), .removed = 0};
+    r.pi = malloc(n * sizeof(double));
+    r.parent = malloc(n * sizeof(unsigned int));
+    r.depth = malloc(n * sizeof(unsigned int));
+    r.degree = malloc(n * sizeof(int));
+    unsigned int edges = 0;
+    for (unsigned int v = 0; v < n; v++)
+    {
+        for (unsigned int u = v + 1; u < n; u++)
+        {
+            edges += matrix_read(rep->graph, n, v, u) != INFINITY;
+        }
+    }
+
+    // Taking edges out can leave cities with two, and forcing edges tightens the bound: go round until neither moves
+    bool changed = true;
+    while (changed)
+    {
+        changed = propagate(&r);
+        changed |= eliminate(&r, cutoff);
+        changed |= isfinite(cutoff) && eliminate_onetree(&r, cutoff);
+    }
+
+    unsigned int forced = 0;
+    for (unsigned int v = 0; v < n; v++)
+    {
+        forced += forced_count(&r, v);
+    }
+    free(r.forced);
+    free(r.pi);
+    free(r.parent);
+    free(r.depth);
+    free(r.degree);
+    if (!tsp_repr_refresh(rep))
+    {
+        exit(1);
+    }
+
+    for (unsigned int v = 0; v < n; v++)
+    {
+        after += rep->short1[v] + rep->short2[v];
+    }
+    after /= 2;
+    (void)edges, (void)forced; // only read by info()
+    info("Reduction: %u of %u edges taken out, %u forced; root bound %f -> %f\n", r.removed, edges, forced / 2, before, after);
+    return after;
+}
@@ -1,585 +1,704 @@
-#include <math.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <mpi.h>
-#include <time.h>
-
-#include "debug.h"
-#include "matrix.h"
-
-#include "lib/nqueue/queue.h"
-
-typedef struct
-{
-    bool valid;
-    unsigned int ncities;
-    double *graph;
-    double *short1;
-    double *short2;
-} tsp_repr;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-    double bound;
-    unsigned int length;
-    unsigned int index;
-} tsp_node;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-} tsp_result;
-
-void tsp_delrepr(tsp_repr t)
-{
-    if (t.graph)
-    {
-        free(t.graph);
-    }
-    if (t.short1)
-    {
-        free(t.short1);
-    }
-    if (t.short2)
-    {
-        free(t.short2);
-    }
-}
-
-tsp_repr tsp_mkrepr(FILE *input)
-{
-    tsp_repr t;
-    t.graph = NULL;
-    t.short1 = NULL;
-    t.short2 = NULL;
-
-    int nroutes = -1;
-    int from = -1, to = -1;
-    double cost = -1;
-
-    if (fscanf(input, "%u %d", &(t.ncities), &nroutes) == 2)
-    {
-        t.graph = matrix_alloc(t.ncities);
-        t.short1 = array_alloc(t.ncities);
-        t.short2 = array_alloc(t.ncities);
-
-        if (!t.graph || !t.short1 || !t.short2)
-        {
-            error("Failed to allocate memory; aborting!\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    for (int i = 0; i < nroutes; i++)
-    {
-        if (fscanf(input, "%d %d %lf", &from, &to, &cost) == 3)
-        {
-            matrix_write(t.graph, t.ncities, from, to, cost);
-            matrix_write(t.graph, t.ncities, to, from, cost);
-
-            if (t.short1[from] > cost)
-            {
-                t.short2[from] = t.short1[from];
-                t.short1[from] = cost;
-            }
-            else if (t.short2[from] > cost)
-            {
-                t.short2[from] = cost;
-            }
-
-            if (t.short1[to] > cost)
-            {
-                t.short2[to] = t.short1[to];
-                t.short1[to] = cost;
-            }
-            else if (t.short2[to] > cost)
-            {
-                t.short2[to] = cost;
-            }
-        }
-        else
-        {
-            error("Error reading file.\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    fclose(input);
-
-    t.valid = true;
-    return t;
-}
-
-tsp_node *tsp_mknode(unsigned int length)
-{
-    tsp_node *node = malloc(sizeof(tsp_node));
-    node->tour = arrayi_alloc(length);
-    return node;
-}
-
-void tsp_delnode(tsp_node *node)
-{
-    if (node->tour)
-    {
-        free(node->tour);
-    }
-
-    free(node);
-}
-
-char *packnode(tsp_node *node, unsigned int ncities)
-{
-    char *buffer = malloc((sizeof(tsp_node) - sizeof(unsigned int *) + ncities * sizeof(unsigned int)));
-    *(unsigned int *)&buffer[0] = node->length;
-    *(unsigned int *)&buffer[4] = node->index;
-    *(double *)&buffer[8] = node->cost;
-    *(double *)&buffer[16] = node->bound;
-
-    for (size_t i = 0; i < node->length; i++)
-    {
-        *(unsigned int *)&buffer[24 + i * 4] = node->tour[i];
-    }
-    return buffer;
-}
-
-tsp_node *unpacknode(char *buffer)
-{
-    unsigned int size = *(unsigned int *)&buffer[0];
-    tsp_node *new = tsp_mknode(size);
-
-    new->length = size;
-    new->index = *(unsigned int *)&buffer[4];
-    new->cost = *(double *)&buffer[8];
-    new->bound = *(double *)&buffer[16];
-    debug("%u %u %f %f\n", size, new->index, new->cost, new->bound);
-    for (size_t i = 0; i < size; i++)
-    {
-        new->tour[i] = *(unsigned int *)&buffer[24 + i * 4];
-    }
-
-    return new;
-}
-
-char tsp_queue_cmp(void *a, void *b)
-{
-    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
-    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
-    {
-        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
-    }
-
-    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
-}
-
-bool array_contains(unsigned int *arr, int size, unsigned int value)
-{
-    for (int i = 0; i < size; i++)
-    {
-        if (arr[i] == value)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-
-tsp_result tsp_exe(int rank, int size, tsp_repr rep, double lowerbound, double limit)
-{
-    double *graph = rep.graph;
-    double *short1 = rep.short1;
-    double *short2 = rep.short2;
-    unsigned int ncities = rep.ncities;
-
-    unsigned int *btour = arrayi_alloc(ncities);
-    double btourcost = limit;
-    btour[0] = 0;
-    tsp_result result;
-
-    MPI_Request sendrequest;
-    MPI_Status status;
-
-    int flag = 0;
-    int paused = 1;
-    int noted = -1, prevnoted = -1;
-    char *recvbuff = NULL, *sendbuff = NULL;
-
-    priority_queue_t *queue = queue_create(tsp_queue_cmp);
-
-    tsp_node *current = NULL, *new = NULL, *recv = NULL;
-    double cost;
-    double update;
-    double newBound;
-
-    // Preamble - push all node 0 neighbours to the various process queues
-    for (size_t i = rank; i < ncities; i = i + size)
-    {
-        cost = matrix_read(graph, ncities, 0, i);
-        if (cost != INFINITY && 0 != i)
-        {
-            update = (cost >= short2[i] ? short2[i] : short1[i]) + (cost >= short2[0] ? short2[0] : short1[0]);
-            newBound = lowerbound + cost - (update / 2);
-            if (newBound > btourcost)
-            {
-                continue;
-            }
-            new = tsp_mknode(2);
-            new->tour[0] = 0;
-            new->tour[1] = i;
-            new->cost = cost;
-            new->bound = newBound;
-            new->length = 2;
-            new->index = i;
-            debug("%d) Pushing node %d with bound %f and cost %f to queue\n", rank, (int)i, new->bound, new->cost);
-            queue_push(queue, new);
-            paused = 0;
-        }
-    }
-
-    if (rank == 0 && size > 1)
-    {
-        sendbuff = malloc((size + 1) * sizeof(char) + sizeof(double));
-
-        for (int i = 0; i < size; i++)
-        {
-            sendbuff[i] = 0;
-        }
-
-        sendbuff[size] = paused;
-
-        *(double *)&sendbuff[size + 1] = limit;
-
-        MPI_Send(sendbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, 1, 1, MPI_COMM_WORLD);
-        free(sendbuff);
-        sendbuff = NULL;
-    }
-
-    int pops = 0;
-    srand(time(NULL));
-    while (1)
-    {
-        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
-
-        if (flag == 1 && size > 1)
-        {
-            flag = 0;
-            if (status.MPI_TAG == 1) // token -> recvbuff[0...size-1] = global_paused[0...size-1], recvbuff[size] = to stop (0 not, 1 maybe, 2 stop), recvbuff[size+1...size+9] = bestcost
-            {
-                recvbuff = malloc((size + 1) * sizeof(char) + sizeof(double));
-                MPI_Recv(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, status.MPI_SOURCE, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                debug("%d) Recieved the token from %d\n", rank, status.MPI_SOURCE);
-
-                if (rank == 0 && recvbuff[size] == 1) // Break all
-                    recvbuff[size] = 2;
-
-                if (rank == 0 && paused == 1 && recvbuff[size] == 0) // Start break chain
-                    recvbuff[size] = 1;
-
-                if (recvbuff[size] == 1 && paused == 0) // Stop break chain
-                {
-                    recvbuff[size] = 0;
-                }
-
-                if (recvbuff[size] == 2) // Breaking
-                {
-                    // All threads are paused, we can stop the execution
-                    MPI_Send(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, rank == size - 1 ? 0 : rank + 1, 1, MPI_COMM_WORLD);
-                    debug("%d) All threads are paused, we can stop the execution\n", rank);
-                    queue_delete(queue);
-                    free(queue);
-                    free(recvbuff);
-                    result.tour = btour;
-                    result.cost = btourcost;
-                    debug("%d) Returning result with cost %f\n", rank, result.cost);
-                    break;
-                }
-
-                if (*(double *)&recvbuff[size + 1] < limit)
-                    limit = *(double *)&recvbuff[size + 1];
-
-                // SETUP SENDING
-                if (btourcost < *(double *)&recvbuff[size + 1])
-                    *(double *)&recvbuff[size + 1] = btourcost;
-
-                noted = -1;
-
-                if (queue->size > ncities)
-                    for (int i = 0; i < size; i++)
-                    {
-                        if (recvbuff[i] == 1 && paused == 0 && prevnoted != i && rank != i)
-                        {
-                            noted = i;
-                            recvbuff[i] = 0;
-                            break;
-                        }
-                    }
-
-                recvbuff[rank] = paused;
-
-                MPI_Send(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, rank == size - 1 ? 0 : rank + 1, 1, MPI_COMM_WORLD);
-
-                free(recvbuff);
-                recvbuff = NULL;
-            }
-            else if (status.MPI_TAG == 2)
-            {
-                paused = 0;
-                recvbuff = malloc((sizeof(tsp_node) - sizeof(unsigned int *) + ncities * sizeof(unsigned int)));
-                debug("%d) Packdge recieved!\n", rank);
-                MPI_Recv(recvbuff, (sizeof(tsp_node) - sizeof(unsigned int *) + (ncities) * sizeof(unsigned int)), MPI_CHAR, status.MPI_SOURCE, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                recv = unpacknode(recvbuff);
-                debug("%d) Packdge recieved: %d %f\n", rank, recv->length, recv->bound);
-                free(recvbuff);
-                recvbuff = NULL;
-                queue_push(queue, recv);
-            }
-        }
-
-        if (queue->size > 0)
-        {
-            current = queue_pop(queue);
-            pops++;
-            // debug("%d) Popping.\n", rank);
-
-            if (current->bound > btourcost || current->bound >= limit)
-            {
-                // If the best node doesn't work, then the others in the queue probably don't work either
-                // Delete all the nodes because they are 100% garbage
-                debug("%d) Clearing the queue.\n", rank);
-                while (queue->size > 0)
-                {
-                    // NOTE: There's some optimization potential here because the bubbe-down step is unnecessary
-                    tsp_delnode(current);
-                    current = queue_pop(queue);
-                }
-            }
-            else if (current->length == ncities)
-            {
-                double newcost = current->cost + matrix_read(graph, ncities, current->index, 0);
-                if (newcost < btourcost && newcost < limit)
-                {
-                    for (size_t i = 1; i < ncities; i++)
-                    {
-                        btour[i] = current->tour[i];
-                    }
-                    btourcost = newcost;
-                }
-            }
-            else if ((pops > 20000 && size > 1 && size < 16) || (pops > 7500 && size > 15) || ((noted > -1) && prevnoted != noted))
-            {
-                int index = 0;
-
-                if (noted > -1)
-                    index = noted;
-                else
-                    index = rand() % size;
-
-                if (index == rank)
-                {
-                    if (rank == 0)
-                        index = size - 1;
-                    else
-                        index--;
-                }
-
-                debug("%d) Sending pops to %d %d, %f, (%f)\n", rank, index, current->length, current->bound, limit);
-                sendbuff = packnode(current, ncities);
-                MPI_Isend(sendbuff, (sizeof(tsp_node) - sizeof(unsigned int *) + (ncities) * sizeof(unsigned int)), MPI_CHAR, index, 2, MPI_COMM_WORLD, &sendrequest);
-
-                if (noted > -1)
-                    prevnoted = noted;
-                else
-                    pops = 0;
-            }
-            else
-            {
-                for (size_t i = 0; i < ncities; i++)
-                {
-                    cost = matrix_read(graph, ncities, current->index, i);
-                    if (cost != INFINITY && i != current->index && !array_contains(current->tour, current->length, (unsigned int)i))
-                    {
-                        update = (cost >= short2[i] ? short2[i] : short1[i]) + (cost >= short2[current->index] ? short2[current->index] : short1[current->index]);
-                        newBound = current->bound + cost - (update / 2);
-                        if (newBound > btourcost || newBound > limit)
-                        {
-                            continue;
-                        }
-                        new = tsp_mknode(current->length + 1);
-                        for (size_t j = 0; j < current->length; j++)
-                        {
-                            new->tour[j] = current->tour[j];
-                        }
-                        new->tour[current->length] = i;
-                        new->cost = current->cost + cost;
-                        new->bound = newBound;
-                        new->length = current->length + 1;
-                        new->index = i;
-
-                        // Distribute the new node to another random process if own queue still has nodes and other process is paused
-                        queue_push(queue, new);
-                    }
-                }
-            }
-            tsp_delnode(current);
-            if ((noted > -1 && prevnoted == noted) || (pops == 0 && size > 1))
-            {
-                debug("%d) Waiting for send.\n", rank);
-                MPI_Wait(&sendrequest, MPI_STATUSES_IGNORE);
-                free(sendbuff);
-                sendbuff = NULL;
-                noted = -1;
-            }
-
-            if (queue->size == 0)
-            {
-                debug("%d) Queue ces't finni!\n", rank);
-                paused = 1;
-                if (size == 1)
-                {
-                    queue_delete(queue);
-                    free(queue);
-                    result.tour = btour;
-                    result.cost = btourcost;
-                    debug("%d) Returning result with cost %f\n", rank, result.cost);
-                    break;
-                }
-            }
-        }
-    }
-    return result;
-}
-
-void help(char *me)
-{
-    printf("USAGE: %s inputfile lowerbound\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
-}
-
-int main(int argc, char *argv[])
-{
-    double limit = INFINITY;
-    double exec_time;
-
-    MPI_Init(&argc, &argv);
-
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    // Argument validation
-    if (argc <= 2 || argc > 3)
-    {
-        if (rank == 0)
-        {
-            error("Too many arguments.\n");
-            help(argv[0]);
-        }
-        MPI_Finalize();
-        return 0;
-    }
-
-    // Make sure that the lowerbound arg is a number
-    if (argc != 3 || atof(argv[2]) <= 0)
-    {
-        // Either the value is 0 (not allowed) or it is not a number.
-        // If that's the case ignore this.
-        if (rank == 0)
-        {
-            error("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
-        }
-        MPI_Finalize();
-        return 0;
-    }
-    else
-    {
-        limit = (double)atof(argv[2]);
-    }
-    info("Cost must be <= %f\n", limit);
-    info("File target: %s\n", argv[1]);
-    FILE *input = fopen(argv[1], "r");
-    if (!input)
-    {
-        if (rank == 0)
-            syserr("Could not open the input file");
-        MPI_Finalize();
-        return 0;
-    }
-
-    tsp_repr t = tsp_mkrepr(input);
-    if (!t.valid)
-    {
-        // An earlier error happened preventing us from carrying on
-        tsp_delrepr(t);
-        MPI_Finalize();
-        return 0;
-    }
-
-    double lowerbound = 0;
-    for (size_t i = 0; i < t.ncities; ++i)
-    {
-        lowerbound += t.short1[i] + t.short2[i];
-    }
-    lowerbound /= 2;
-    info("Lowerbound at root = %f\n", lowerbound);
-    double *overallbest = malloc(size * sizeof(double));
-
-    exec_time = -MPI_Wtime();
-
-    tsp_result result = tsp_exe(rank, size, t, lowerbound, limit);
-    MPI_Barrier(MPI_COMM_WORLD);
-    MPI_Allgather(&result.cost, 1, MPI_DOUBLE, overallbest, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-
-    exec_time += MPI_Wtime();
-
-    if (rank == 0)
-        fprintf(stderr, "%.1fs\n", exec_time);
-
-    int index = -1;
-    double min = limit;
-    for (int i = 0; i < size; i++)
-    {
-        if (overallbest[i] < min)
-        {
-            index = i;
-            min = overallbest[i];
-        }
-    }
-    free(overallbest);
-    // printf("%f %f %d %d\n", overallbest, result.cost, result.tour[1], result.tour[t.ncities - 1]);
-
-    if (index == rank)
-    {
-        if (lowerbound > limit)
-        {
-            info("Lowerbound %f is higher than the desired limit %f.\n", lowerbound, limit);
-            printf("NO SOLUTION\n");
-        }
-        else if (result.cost > limit)
-        {
-            info("Either the graph is not connected OR the lowerbound limit is too low!\n");
-            printf("NO SOLUTION\n");
-        }
-        else
-        {
-            // Print the tour
-            printf("%.1f\n", result.cost);
-            printf("%d", result.tour[0]);
-            for (size_t i = 1; i < t.ncities; ++i)
-            {
-                printf(" %d", result.tour[i]);
-            }
-            printf(" 0\n");
-        }
-    }
-
-    // Cleanup
-    free(result.tour);
-    tsp_delrepr(t);
-    MPI_Finalize();
-    return 0;
-}
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <time.h>
+
+#include "bound.h"
+#include "debug.h"
+#include "dominance.h"
+#include "endgame.h"
+#include "feasible.h"
+#include "expand.h"
+#include "heuristic.h"
+#include "mirror.h"
+#include "options.h"
+#include "reduce.h"
+#include "relabel.h"
+#include "matrix.h"
+#include "node.h"
+#include "repr.h"
+
+#include "lib/nqueue/queue.h"
+
+#ifndef TSP_BUCKETS
+#define TSP_BUCKETS 0
+#endif
+
+typedef struct
+{
+    unsigned int *tour;
+    double cost;
+} tsp_result;
+
+char *packnode(tsp_node *node, unsigned int ncities)
+{
+    char *buffer = malloc(tsp_node_packsize(ncities));
+    tsp_node_pack(node, buffer);
+    return buffer;
+}
+
+tsp_node *unpacknode(char *buffer)
+{
+    tsp_node *new = tsp_node_unpack(buffer);
+    debug("%u %u %f %f\n", new->length, new->index, new->cost, new->bound);
+    return new;
+}
+
+void tsp_queue_delnode(void *node)
+{
+    tsp_delnode(node);
+}
+
+// Delete every queued node whose bound is above cost
+void tsp_queue_prune(priority_queue_t *queue, double cost)
+{
+    // With the largest possible index, nodes that tie with cost still sort before the threshold
+    tsp_node threshold = {.bound = cost, .index = UINT_MAX};
+    queue_prune(queue, &threshold, tsp_queue_delnode);
+}
+
+char tsp_queue_cmp(void *a, void *b)
+{
+    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
+    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
+    {
+        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
+    }
+
+    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
+}
+
+#if TSP_BUCKETS
+// Bounds are multiples of 0.05 (costs have one decimal), so twenty keys per unit of cost
+long tsp_queue_key(void *a)
+{
+    double key = ((tsp_node *)a)->bound * 20;
+    return key < LONG_MAX / 2 ? (long)(key + 0.5) : LONG_MAX / 2;
+}
+#endif
+
+// Hand every process's weighed tours to process 0, which picks the one a single process would have
+// reported into tour. Returns its cost on process 0 (INFINITY if there is none), and INFINITY elsewhere.
+double tsp_gather_tours(int rank, int size, tsp_repr rep, double lowerbound, double upper, tsp_mirror_pool *pool,
+                         unsigned int *tour)
+{
+    unsigned int ncities = rep.ncities;
+    int count = (int)tsp_mirror_count(pool);
+    // Keys travel as three doubles: cost, bound and index
+    double *keys = malloc((3 * (size_t)count + 1) * sizeof(double));
+    unsigned int *tours = malloc(((size_t)count * ncities + 1) * sizeof(unsigned int));
+    for (int i = 0; i < count; i++)
+    {
+        tsp_mirror_key key = tsp_mirror_key_at(pool, i);
+        keys[3 * i] = key.cost;
+        keys[3 * i + 1] = key.bound;
+        keys[3 * i + 2] = key.index;
+        memcpy(&tours[(size_t)i * ncities], tsp_mirror_tour_at(pool, i), ncities * sizeof(unsigned int));
+    }
+
+    int *counts = NULL, *keycounts = NULL, *keydispls = NULL, *tourcounts = NULL, *tourdispls = NULL;
+    double *allkeys = NULL;
+    unsigned int *alltours = NULL;
+    int total = 0;
+    if (rank == 0)
+    {
+        counts = malloc(size * sizeof(int));
+        keycounts = malloc(size * sizeof(int));
+        keydispls = malloc(size * sizeof(int));
+        tourcounts = malloc(size * sizeof(int));
+        tourdispls = malloc(size * sizeof(int));
+    }
+    MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            keycounts[i] = 3 * counts[i];
+            keydispls[i] = 3 * total;
+            tourcounts[i] = counts[i] * (int)ncities;
+            tourdispls[i] = total * (int)ncities;
+            total += counts[i];
+        }
+        allkeys = malloc((3 * (size_t)total + 1) * sizeof(double));
+        alltours = malloc(((size_t)total * ncities + 1) * sizeof(unsigned int));
+    }
+    MPI_Gatherv(keys, 3 * count, MPI_DOUBLE, allkeys, keycounts, keydispls, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(tours, count * (int)ncities, MPI_UNSIGNED, alltours, tourcounts, tourdispls, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    free(keys);
+    free(tours);
+
+    double cost = INFINITY;
+    if (rank == 0)
+    {
+        tsp_mirror_pool *all = tsp_mirror_pool_create(rep, lowerbound, upper);
+        for (int i = 0; i < total; i++)
+        {
+            tsp_mirror_key key = {.cost = allkeys[3 * i], .bound = allkeys[3 * i + 1], .index = (unsigned int)allkeys[3 * i + 2]};
+            tsp_mirror_add(all, key, &alltours[(size_t)i * ncities]);
+        }
+        cost = tsp_mirror_pick(all, tour).cost;
+        tsp_mirror_pool_delete(all);
+        free(counts);
+        free(keycounts);
+        free(keydispls);
+        free(tourcounts);
+        free(tourdispls);
+        free(allkeys);
+        free(alltours);
+    }
+    return cost;
+}
+
+// Search from the heuristic tour btour, of cost seed, which becomes the result's tour. Tours are weighed on
+// whole, the graph before --reduce=edges took edges out of rep, whose root bound is wholebound.
+tsp_result tsp_exe(int rank, int size, tsp_repr rep, double lowerbound, tsp_repr whole, double wholebound, double limit,
+                   double seed, unsigned int *btour, tsp_options options)
+{
+    double *graph = rep.graph;
+    double *delta = rep.delta;
+    unsigned int ncities = rep.ncities;
+    // Children that survive bounding, as handed out by tsp_expand
+    unsigned int *cities = arrayi_alloc(ncities);
+    double *bounds = array_alloc(ncities);
+
+    // Start from the heuristic tour. Half a cost step above it prunes nearly as hard as the tour itself
+    // would, and still leaves room for the search to find (and report) its own optimal tour.
+    const double upper = seed + TSP_COST_STEP / 2;
+    double btourcost = upper < limit ? upper : limit;
+    btour[0] = 0;
+    // Unless the search finds a tour of its own, the heuristic one stands, at its own cost: btourcost
+    // may have started at limit, below it
+    bool found = false;
+    // With more than one process, --symmetry=break, --relabel, --endgame, --bound=1tree or --reduce=edges, tours
+    // are weighed as the full search on the input would have, on one process: the incumbent as it would see it,
+    // and room to turn tours around
+    const bool weigh =
+        size > 1 || options.symmetry || rep.label || options.endgame || options.bound == TSP_BOUND_ONETREE || options.reduce;
+    tsp_mirror_pool *pool = weigh ? tsp_mirror_pool_create(whole, wholebound, upper) : NULL;
+    // limit comes down to the best cost any process has found; tours are weighed against the one asked for
+    const double asked = limit;
+    if (weigh)
+    {
+        // Weighing, the search reaches a rounding error past the limit: a tour whose bound lands just over
+        // it one way round may still be under it the other way round
+        limit += TSP_COST_SLACK(limit);
+        btourcost = upper < limit ? upper : limit;
+    }
+    unsigned int *tour = weigh ? arrayi_alloc(ncities) : NULL;
+    tsp_result result;
+
+    MPI_Request sendrequest;
+    MPI_Status status;
+
+    int flag = 0;
+    int paused = 1;
+    int noted = -1, prevnoted = -1;
+    char *recvbuff = NULL, *sendbuff = NULL;
+
+    // Only set with --bound=1tree; every process works out the same root penalties on its own
+    tsp_bound *onetree = options.bound == TSP_BOUND_ONETREE ? tsp_bound_create(rep) : NULL;
+    unsigned long expanded = 0;
+    // Only set with --dominance; every process keeps its own
+    tsp_dominance *dominance = options.dominance ? tsp_dominance_create(ncities, options.dominance, options.symmetry) : NULL;
+    // Only set with --endgame
+    tsp_endgame *endgame = options.endgame ? tsp_endgame_create(rep, options.endgame) : NULL;
+    // Only set with --feasibility=check
+    tsp_feasible *feasible = options.feasibility ? tsp_feasible_create(rep) : NULL;
+    unsigned long infeasible = 0;
+
+    tsp_pool_init(ncities, onetree ? tsp_bound_extra(ncities) : 0);
+#if TSP_BUCKETS
+    priority_queue_t *queue = queue_create_buckets(tsp_queue_cmp, tsp_queue_key);
+#else
+    priority_queue_t *queue = queue_create(tsp_queue_cmp);
+#endif
+
+    tsp_node *current = NULL, *new = NULL, *recv = NULL, *root = tsp_node_root(lowerbound);
+    double cost;
+    double newBound;
+    if (onetree)
+    {
+        root->bound = tsp_bound_root(onetree, root, btourcost);
+    }
+
+    // Preamble - push all node 0 neighbours to the various process queues. They are dealt out by the
+    // input's numbers, so that --relabel hands every process the same cities as without it
+    for (size_t i = 1; i < ncities; i++)
+    {
+        cost = matrix_read(graph, ncities, 0, i);
+        if (cost != INFINITY && tsp_repr_label(rep, i) % size == (unsigned int)rank)
+        {
+            newBound = lowerbound + matrix_read(delta, ncities, 0, i);
+            // Breaking symmetry, a tour starting 0 -> ncities-1 could only come back through a lower city
+            if (newBound > btourcost || (options.symmetry && ncities > 2 && i == ncities - 1))
+            {
+                continue;
+            }
+            new = tsp_node_child(root, i);
+            new->cost = cost;
+            new->bound = newBound;
+            if (feasible && !tsp_feasible_child(feasible, 0, new))
+            {
+                infeasible++;
+                tsp_delnode(new);
+                continue;
+            }
+            if (onetree && (new->bound = tsp_bound_child(onetree, root, new, btourcost)) > btourcost)
+            {
+                tsp_delnode(new);
+                continue;
+            }
+            if (dominance && tsp_dominance_insert(dominance, new))
+            {
+                tsp_delnode(new);
+                continue;
+            }
+            debug("%d) Pushing node %d with bound %f and cost %f to queue\n", rank, (int)i, new->bound, new->cost);
+            queue_push(queue, new);
+            paused = 0;
+        }
+    }
+    tsp_delnode(root);
+
+    if (rank == 0 && size > 1)
+    {
+        sendbuff = malloc((size + 1) * sizeof(char) + sizeof(double));
+
+        for (int i = 0; i < size; i++)
+        {
+            sendbuff[i] = 0;
+        }
+
+        sendbuff[size] = paused;
+
+        *(double *)&sendbuff[size + 1] = limit;
+
+        MPI_Send(sendbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, 1, 1, MPI_COMM_WORLD);
+        free(sendbuff);
+        sendbuff = NULL;
+    }
+
+    int pops = 0;
+    srand(time(NULL));
+    while (1)
+    {
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+
+        if (flag == 1 && size > 1)
+        {
+            flag = 0;
+            if (status.MPI_TAG == 1) // token -> recvbuff[0...size-1] = global_paused[0...size-1], recvbuff[size] = to stop (0 not, 1 maybe, 2 stop), recvbuff[size+1...size+9] = bestcost
+            {
+                recvbuff = malloc((size + 1) * sizeof(char) + sizeof(double));
+                MPI_Recv(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, status.MPI_SOURCE, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                debug("%d) Recieved the token from %d\n", rank, status.MPI_SOURCE);
+
+                if (rank == 0 && recvbuff[size] == 1) // Break all
+                    recvbuff[size] = 2;
+
+                if (rank == 0 && paused == 1 && recvbuff[size] == 0) // Start break chain
+                    recvbuff[size] = 1;
+
+                if (recvbuff[size] == 1 && paused == 0) // Stop break chain
+                {
+                    recvbuff[size] = 0;
+                }
+
+                if (recvbuff[size] == 2) // Breaking
+                {
+                    // All threads are paused, we can stop the execution
+                    MPI_Send(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, rank == size - 1 ? 0 : rank + 1, 1, MPI_COMM_WORLD);
+                    debug("%d) All threads are paused, we can stop the execution\n", rank);
+                    queue_delete(queue);
+                    free(queue);
+                    free(recvbuff);
+                    result.tour = btour;
+                    result.cost = found ? btourcost : seed;
+                    debug("%d) Returning result with cost %f\n", rank, result.cost);
+                    break;
+                }
+
+                if (*(double *)&recvbuff[size + 1] < limit)
+                    limit = *(double *)&recvbuff[size + 1];
+
+                // SETUP SENDING
+                if (btourcost < *(double *)&recvbuff[size + 1])
+                    *(double *)&recvbuff[size + 1] = btourcost;
+
+                noted = -1;
+
+                if (queue->size > ncities)
+                    for (int i = 0; i < size; i++)
+                    {
+                        if (recvbuff[i] == 1 && paused == 0 && prevnoted != i && rank != i)
+                        {
+                            noted = i;
+                            recvbuff[i] = 0;
+                            break;
+                        }
+                    }
+
+                recvbuff[rank] = paused;
+
+                MPI_Send(recvbuff, ((size + 1) * sizeof(char) + sizeof(double)), MPI_CHAR, rank == size - 1 ? 0 : rank + 1, 1, MPI_COMM_WORLD);
+
+                free(recvbuff);
+                recvbuff = NULL;
+            }
+            else if (status.MPI_TAG == 2)
+            {
+                paused = 0;
+                recvbuff = malloc(tsp_node_packsize(ncities));
+                debug("%d) Packdge recieved!\n", rank);
+                MPI_Recv(recvbuff, tsp_node_packsize(ncities), MPI_CHAR, status.MPI_SOURCE, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                recv = unpacknode(recvbuff);
+                debug("%d) Packdge recieved: %d %f\n", rank, recv->length, recv->bound);
+                free(recvbuff);
+                recvbuff = NULL;
+                queue_push(queue, recv);
+            }
+        }
+
+        if (queue->size > 0)
+        {
+            current = queue_pop(queue);
+            pops++;
+            // debug("%d) Popping.\n", rank);
+
+            // Weighing tours, those that tie with the incumbent (give or take rounding) still have to be seen
+            if (current->bound > btourcost || current->bound > limit || (!weigh && current->bound == limit))
+            {
+                // If the best node doesn't work, then the others in the queue probably don't work either
+                // Delete all the nodes because they are 100% garbage
+                debug("%d) Clearing the queue.\n", rank);
+                // current is the smallest node left, so nothing in the queue comes before it
+                queue_prune(queue, current, tsp_queue_delnode);
+            }
+            else if (current->length == ncities && weigh)
+            {
+                // Which of the tours that tie is reported is only settled once every process is done
+                tsp_node_tour(current, tour);
+                double cutoff = tsp_mirror_offer(pool, tour, asked);
+                if (cutoff < btourcost)
+                {
+                    btourcost = cutoff;
+                    tsp_queue_prune(queue, btourcost);
+                }
+            }
+            else if (current->length == ncities)
+            {
+                double newcost = current->cost + matrix_read(graph, ncities, current->index, 0);
+                if (newcost < btourcost && newcost < limit)
+                {
+                    tsp_node_tour(current, btour);
+                    btourcost = newcost;
+                    found = true;
+                    tsp_queue_prune(queue, btourcost);
+                }
+            }
+            else if (dominance && tsp_dominance_stale(dominance, current))
+            {
+                // A cheaper way to the same cities turned up while this node was queued
+            }
+            else if (endgame && tsp_endgame_covers(endgame, current))
+            {
+                // The rest of the tour comes back as complete nodes, which take their turn in the queue like any other
+                double threshold = btourcost < limit ? btourcost : limit;
+                tsp_endgame_solve(endgame, current, onetree ? tsp_bound_halfsum(current) : current->bound, threshold);
+                for (tsp_node *complete; (complete = tsp_endgame_next(endgame));)
+                {
+                    queue_push(queue, complete);
+                }
+            }
+            else if ((pops > 20000 && size > 1 && size < 16) || (pops > 7500 && size > 15) || ((noted > -1) && prevnoted != noted))
+            {
+                int index = 0;
+
+                if (noted > -1)
+                    index = noted;
+                else
+                    index = rand() % size;
+
+                if (index == rank)
+                {
+                    if (rank == 0)
+                        index = size - 1;
+                    else
+                        index--;
+                }
+
+                debug("%d) Sending pops to %d %d, %f, (%f)\n", rank, index, current->length, current->bound, limit);
+                sendbuff = packnode(current, ncities);
+                MPI_Isend(sendbuff, tsp_node_packsize(ncities), MPI_CHAR, index, 2, MPI_COMM_WORLD, &sendrequest);
+
+                if (noted > -1)
+                    prevnoted = noted;
+                else
+                    pops = 0;
+            }
+            else
+            {
+                double threshold = btourcost < limit ? btourcost : limit;
+                double base = onetree ? tsp_bound_halfsum(current) : current->bound;
+                unsigned int found = tsp_expand_city(&rep, current->index, tsp_node_visited(current), base, threshold, cities, bounds);
+                if (options.symmetry)
+                {
+                    found = tsp_mirror_filter(current, ncities, cities, bounds, found);
+                }
+                expanded++;
+                for (unsigned int k = 0; k < found; k++)
+                {
+                    new = tsp_node_child(current, cities[k]);
+                    new->cost = current->cost + matrix_read(graph, ncities, current->index, cities[k]);
+                    new->bound = bounds[k];
+                    if (feasible && !tsp_feasible_child(feasible, current->index, new))
+                    {
+                        infeasible++;
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    if (onetree && (new->bound = tsp_bound_child(onetree, current, new, threshold)) > threshold)
+                    {
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    if (dominance && tsp_dominance_insert(dominance, new))
+                    {
+                        tsp_delnode(new);
+                        continue;
+                    }
+
+                    // Distribute the new node to another random process if own queue still has nodes and other process is paused
+                    queue_push(queue, new);
+                }
+            }
+            tsp_delnode(current);
+            if ((noted > -1 && prevnoted == noted) || (pops == 0 && size > 1))
+            {
+                debug("%d) Waiting for send.\n", rank);
+                MPI_Wait(&sendrequest, MPI_STATUSES_IGNORE);
+                free(sendbuff);
+                sendbuff = NULL;
+                noted = -1;
+            }
+
+            if (queue->size == 0)
+            {
+                debug("%d) Queue ces't finni!\n", rank);
+                paused = 1;
+                if (size == 1)
+                {
+                    queue_delete(queue);
+                    free(queue);
+                    result.tour = btour;
+                    result.cost = found ? btourcost : seed;
+                    debug("%d) Returning result with cost %f\n", rank, result.cost);
+                    break;
+                }
+            }
+        }
+    }
+    if (pool)
+    {
+        // Only process 0's result counts from here on
+        double cost = tsp_gather_tours(rank, size, whole, wholebound, upper, pool, btour);
+        result.cost = cost == INFINITY ? seed : cost;
+        tsp_mirror_pool_delete(pool);
+    }
+    info("%d) Expanded %lu nodes\n", rank, expanded);
+    if (dominance)
+    {
+        tsp_dominance_stats stats = tsp_dominance_stats_of(dominance);
+        (void)stats; // only read by info()
+        info("%d) Dominance table: %zu slots in %.1f MiB, %lu lookups, %.1f%% hits, %lu pruned\n", rank, stats.slots,
+             stats.bytes / 1048576.0, stats.lookups, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0, stats.pruned);
+        tsp_dominance_delete(dominance);
+    }
+    if (endgame)
+    {
+        tsp_endgame_stats stats = tsp_endgame_stats_of(endgame);
+        (void)stats; // only read by info()
+        info("%d) Endgame: %lu nodes solved, %lu completed, %lu memo lookups, %.1f%% hits\n", rank, stats.solved, stats.completed,
+             stats.lookups, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0);
+        tsp_endgame_delete(endgame);
+    }
+    if (feasible)
+    {
+        info("%d) Feasibility: %lu nodes dropped\n", rank, infeasible);
+        tsp_feasible_delete(feasible);
+    }
+    tsp_pool_release();
+    if (onetree)
+    {
+        tsp_bound_delete(onetree);
+    }
+    free(tour);
+    free(cities);
+    free(bounds);
+    return result;
+}
+
+void help(char *me)
+{
+    printf("USAGE: %s inputfile lowerbound [options]\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
+    tsp_options_help(false);
+}
+
+int main(int argc, char *argv[])
+{
+    double limit = INFINITY;
+    double exec_time;
+    tsp_options options;
+    const char *bad = NULL;
+
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Argument validation
+    if (argc <= 2 || (bad = tsp_options_parse(&options, argc, argv, 3, false)))
+    {
+        if (rank == 0)
+        {
+            if (bad)
+                error("Unknown option: %s\n", bad);
+            else
+                error("No arguments provided.\n");
+            help(argv[0]);
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Make sure that the lowerbound arg is a number
+    if (atof(argv[2]) <= 0)
+    {
+        // Either the value is 0 (not allowed) or it is not a number.
+        // If that's the case ignore this.
+        if (rank == 0)
+        {
+            error("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
+        }
+        MPI_Finalize();
+        return 0;
+    }
+    else
+    {
+        limit = (double)atof(argv[2]);
+    }
+    info("Cost must be <= %f\n", limit);
+    info("File target: %s\n", argv[1]);
+    FILE *input = fopen(argv[1], "r");
+    if (!input)
+    {
+        if (rank == 0)
+            syserr("Could not open the input file");
+        MPI_Finalize();
+        return 0;
+    }
+
+    tsp_repr t = tsp_mkrepr(input);
+    if (!t.valid)
+    {
+        // An earlier error happened preventing us from carrying on
+        tsp_delrepr(t);
+        MPI_Finalize();
+        return 0;
+    }
+
+    double lowerbound = 0;
+    for (size_t i = 0; i < t.ncities; ++i)
+    {
+        lowerbound += t.short1[i] + t.short2[i];
+    }
+    lowerbound /= 2;
+    info("Lowerbound at root = %f\n", lowerbound);
+
+    exec_time = -MPI_Wtime();
+
+    tsp_expand_init();
+    // One heuristic tour serves both the edge elimination and the search; every process works it out
+    // on its own, and they all come up with the same one
+    unsigned int *btour = arrayi_alloc(t.ncities);
+    double start = MPI_Wtime();
+    double seed = tsp_heuristic(t, btour);
+    (void)start; // only read by info()
+    if (rank == 0)
+    {
+        info("Heuristic tour: %.1f in %.3fs\n", seed, MPI_Wtime() - start);
+    }
+    // lowerbound stays as summed in the input's order, which the search on renumbered cities has to match
+    if (options.relabel && !tsp_relabel(&t, btour))
+    {
+        free(btour);
+        tsp_delrepr(t);
+        MPI_Finalize();
+        return 0;
+    }
+    // Tours are still weighed on every edge the input has
+    tsp_repr whole = t;
+    double wholebound = lowerbound;
+    if (options.reduce)
+    {
+        whole = tsp_repr_copy(t);
+        if (!whole.valid)
+        {
+            free(btour);
+            tsp_delrepr(whole);
+            tsp_delrepr(t);
+            MPI_Finalize();
+            return 0;
+        }
+        lowerbound = tsp_reduce(&t, limit, seed);
+    }
+    tsp_result result = tsp_exe(rank, size, t, lowerbound, whole, wholebound, limit, seed, btour, options);
+    tsp_relabel_tour(t, result.tour);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    exec_time += MPI_Wtime();
+
+    // Process 0 holds the tour every process agreed on
+    if (rank == 0)
+    {
+        fprintf(stderr, "%.1fs\n", exec_time);
+        // The reduced graph's bound can come out a rounding error over a tour right on the limit
+        if (wholebound > limit)
+        {
+            info("Lowerbound %f is higher than the desired limit %f.\n", wholebound, limit);
+            printf("NO SOLUTION\n");
+        }
+        else if (result.cost > limit)
+        {
+            info("Either the graph is not connected OR the lowerbound limit is too low!\n");
+            printf("NO SOLUTION\n");
+        }
+        else
+        {
+            // Print the tour
+            printf("%.1f\n", result.cost);
+            printf("%d", result.tour[0]);
+            for (size_t i = 1; i < t.ncities; ++i)
+            {
+                printf(" %d", result.tour[i]);
+            }
+            printf(" 0\n");
+        }
+    }
+
+    // Cleanup
+    free(result.tour);
+    if (options.reduce)
+    {
+        tsp_delrepr(whole);
+    }
+    tsp_delrepr(t);
+    MPI_Finalize();
+    return 0;
+}
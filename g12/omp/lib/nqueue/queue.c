@@ -1,138 +1,397 @@
-#include "queue.h"
-
-#define REALLOC_SIZE 1024
-#define SWAP(x, y) void* tmp = x; x = y; y = tmp;
-
-// Return the index of the parent node
-static size_t parent_of(size_t i)
-{
-	return (i - 1) / 2;
-}
-
-// Bubble-down the element to the correct position
-// (i.e., compare it to its child and then swap them if necessary).
-// Assume that all the elements in the subtree is already sorted.
-void bubble_down(priority_queue_t *queue, size_t node)
-{
-	size_t left_child = 2 * node + 1;
-	size_t right_child = 2 * node + 2;
-	size_t i = node;
-	
-	// Compare with the left node
-	if (left_child < queue->size &&
-	    queue->cmpfn(queue->buffer[node], queue->buffer[left_child]))
-	{
-		i = left_child;
-	}
-	
-	// Compare with the right node
-	if (right_child < queue->size && queue->cmpfn(queue->buffer[i], queue->buffer[right_child]))
-	{
-		i = right_child;
-	}
-	
-	// If node is not in the correct position, swap and then sort the subtree
-	if (i != node)
-	{
-		SWAP(queue->buffer[i], queue->buffer[node])
-		bubble_down(queue, i);
-	}
-}
-
-// Create a new priority queue
-priority_queue_t *queue_create(char (*cmp)(void *, void *))
-{
-	priority_queue_t *queue;
-
-	queue = malloc(sizeof(priority_queue_t));
-
-	queue->buffer = malloc(REALLOC_SIZE * sizeof(void*));
-	queue->max_size = REALLOC_SIZE;
-	queue->size = 0;
-	queue->cmpfn = cmp;
-	
-	return queue;
-}
-
-// Delete the priority queue
-void queue_delete(priority_queue_t *queue)
-{
-	queue->size = -1;
-	queue->max_size = -1;
-	free(queue->buffer);
-}
-
-// Insert a new element in the queue and then sort its contents.
-void queue_push(priority_queue_t *queue, void* new_element)
-{
-	// Reallocate buffer if necessary
-	if (queue->size + 1 > queue->max_size)
-	{
-		queue->max_size += REALLOC_SIZE;
-		queue->buffer = realloc(queue->buffer, queue->max_size * sizeof(void*));
-	}
-	
-	// Insert the new_element at the end of the buffer
-	size_t node = queue->size;
-	queue->buffer[queue->size++] = new_element;
-
-	// Bubble-up the new element to the correct position
-	// (i.e., compare it to the parent and then swap them if necessary)
-	while (node > 0 && queue->cmpfn(queue->buffer[parent_of(node)], queue->buffer[node]))
-	{
-		size_t parent = parent_of(node);
-		SWAP(queue->buffer[node], queue->buffer[parent])
-		node = parent;
-	}
-}
-
-// Return the element with the lowest value in the queue, after removing it.
-void* queue_pop(priority_queue_t *queue)
-{
-        if(queue->size == 0)
-	    return NULL;
-
-        // Stores the lowest element in a temporary
-	void* top_val = queue->buffer[0];
-	
-	// Put the last element in the queue in the front.
-	queue->buffer[0] = queue->buffer[queue->size - 1];
-	
-	// Remove the duplicated element in the back.
-	--queue->size;
-	
-	// Sort the queue based on the value of the nodes.
-	bubble_down(queue, 0);
-	
-	return top_val;
-}
-
-// Duplicate queue
-priority_queue_t *queue_duplicate(priority_queue_t* queue)
-{
-	priority_queue_t *other;
-	other = malloc(sizeof(priority_queue_t));
-	other->max_size = queue->max_size;
-	other->size = queue->size;
-	other->cmpfn = queue->cmpfn;
-	other->buffer = malloc(queue->max_size * sizeof(void*));
-	memcpy(other->buffer, queue->buffer, queue->max_size * sizeof(void*));
-
-	return other;
-}
-
-// Print the contents of the priority queue
-void queue_print(priority_queue_t* queue, FILE *fp,
-		 void (*print_node)(FILE *, void*))
-{
-	priority_queue_t *queue_copy = queue_duplicate(queue);
-	
-	while (queue_copy->size > 0)
-	{
-		void* node = queue_pop(queue_copy);
-		print_node(fp, node);
-	}
-
-	queue_delete(queue_copy);
-	free(queue_copy);
-}
+#include "queue.h"
+
+#define INITIAL_SIZE 1024
+
+// Number of children per node. A wider heap is shallower, and the children of a node
+// share a cache line, so sifting touches far fewer lines than a binary heap would.
+#define ARITY 4
+
+// Bucket queues: room for the first elements of a bucket, and the window sizes (powers of two)
+#define BUCKET_SIZE 16
+#define INITIAL_BUCKETS 1024
+#define MAX_BUCKETS (1 << 20)
+
+// A heap holding the elements that share one key of a bucket queue
+struct queue_bucket
+{
+	void** buffer;
+	size_t size;
+	size_t max_size;
+};
+
+// Return the index of the parent node
+static size_t parent_of(size_t i)
+{
+	return (i - 1) / ARITY;
+}
+
+// Bubble-down the element to the correct position.
+// The element is held aside and the smallest child moves up into the hole until the element fits.
+// Assume that all the elements in the subtree is already sorted.
+static void bubble_down(void **buffer, size_t size, size_t node, char (*cmpfn)(void *, void *))
+{
+	void *element = buffer[node];
+
+	while (ARITY * node + 1 < size)
+	{
+		size_t first = ARITY * node + 1;
+		size_t last = first + ARITY < size ? first + ARITY : size;
+		size_t best = first;
+
+		// Find the smallest child
+		for (size_t child = first + 1; child < last; child++)
+		{
+			if (cmpfn(buffer[best], buffer[child]))
+			{
+				best = child;
+			}
+		}
+
+		if (!cmpfn(element, buffer[best]))
+		{
+			break;
+		}
+
+		buffer[node] = buffer[best];
+		node = best;
+	}
+
+	buffer[node] = element;
+}
+
+// Bubble-up the element to the correct position, moving parents down into the hole
+static void bubble_up(void **buffer, size_t node, char (*cmpfn)(void *, void *))
+{
+	void *element = buffer[node];
+
+	while (node > 0 && cmpfn(buffer[parent_of(node)], element))
+	{
+		buffer[node] = buffer[parent_of(node)];
+		node = parent_of(node);
+	}
+
+	buffer[node] = element;
+}
+
+// Insert into a heap, growing its buffer geometrically so that a huge frontier only needs a handful of reallocs
+static void heap_push(void ***buffer, size_t *size, size_t *max_size, size_t initial_size,
+		      void *new_element, char (*cmpfn)(void *, void *))
+{
+	if (*size + 1 > *max_size)
+	{
+		*max_size = *max_size ? 2 * *max_size : initial_size;
+		*buffer = realloc(*buffer, *max_size * sizeof(void*));
+	}
+
+	(*buffer)[(*size)++] = new_element;
+	bubble_up(*buffer, *size - 1, cmpfn);
+}
+
+// Remove the top of a non-empty heap
+static void *heap_pop(void **buffer, size_t *size, char (*cmpfn)(void *, void *))
+{
+	// Stores the lowest element in a temporary
+	void* top_val = buffer[0];
+
+	// Put the last element in the queue in the front and remove the duplicate in the back.
+	buffer[0] = buffer[--*size];
+
+	// Sort the queue based on the value of the nodes.
+	bubble_down(buffer, *size, 0, cmpfn);
+
+	return top_val;
+}
+
+// Keep only the elements that come strictly before threshold and return how many there are.
+// Survivors are compacted in place and the heap is rebuilt bottom-up, which is linear in the size.
+static size_t heap_prune(void **buffer, size_t size, void *threshold, void (*destructor)(void *),
+			 char (*cmpfn)(void *, void *))
+{
+	size_t kept = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (cmpfn(threshold, buffer[i]))
+		{
+			buffer[kept++] = buffer[i];
+		}
+		else if (destructor)
+		{
+			destructor(buffer[i]);
+		}
+	}
+
+	// Rebuild from the parent of the last survivor; with fewer than two there is nothing to order
+	if (kept != size && kept > 1)
+	{
+		for (size_t node = (kept - 2) / ARITY + 1; node-- > 0;)
+		{
+			bubble_down(buffer, kept, node, cmpfn);
+		}
+	}
+
+	return kept;
+}
+
+// Bucket holding the given key, if the key is inside the window
+static struct queue_bucket *bucket_of(priority_queue_t *queue, long key)
+{
+	return queue->buckets + ((unsigned long)key & (queue->nbuckets - 1));
+}
+
+// Double the window, moving every bucket to its slot in the wider one
+static void buckets_grow(priority_queue_t *queue)
+{
+	struct queue_bucket *old = queue->buckets;
+	size_t nold = queue->nbuckets;
+
+	queue->nbuckets *= 2;
+	queue->buckets = calloc(queue->nbuckets, sizeof(struct queue_bucket));
+
+	for (size_t i = 0; i < nold; i++)
+	{
+		if (old[i].size > 0)
+		{
+			*bucket_of(queue, queue->keyfn(old[i].buffer[0])) = old[i];
+		}
+		else
+		{
+			free(old[i].buffer);
+		}
+	}
+	free(old);
+}
+
+// Bucket queue insertion. Keys in [base, base + nbuckets) go to their bucket in O(1); anything else
+// (below the window, or too far above it) is spilled into the regular heap kept in queue->buffer.
+static void bucket_push(priority_queue_t *queue, void *new_element)
+{
+	long key = queue->keyfn(new_element);
+
+	// An empty window can be moved anywhere
+	if (queue->size == queue->spilled)
+	{
+		queue->base = key;
+	}
+
+	if (key >= queue->base)
+	{
+		unsigned long offset = (unsigned long)key - (unsigned long)queue->base;
+
+		while (offset >= queue->nbuckets && offset < MAX_BUCKETS)
+		{
+			buckets_grow(queue);
+		}
+
+		if (offset < queue->nbuckets)
+		{
+			struct queue_bucket *bucket = bucket_of(queue, key);
+			heap_push(&bucket->buffer, &bucket->size, &bucket->max_size, BUCKET_SIZE, new_element, queue->cmpfn);
+			queue->size++;
+			return;
+		}
+	}
+
+	heap_push(&queue->buffer, &queue->spilled, &queue->max_size, INITIAL_SIZE, new_element, queue->cmpfn);
+	queue->size++;
+}
+
+// Slide the window up to the first non-empty bucket and return it, or NULL if every element left
+// was spilled.
+static struct queue_bucket *bucket_first(priority_queue_t *queue)
+{
+	struct queue_bucket *bucket = NULL;
+
+	if (queue->size > queue->spilled)
+	{
+		for (bucket = bucket_of(queue, queue->base); bucket->size == 0; bucket = bucket_of(queue, queue->base))
+		{
+			queue->base++;
+		}
+	}
+
+	return bucket;
+}
+
+// Bucket queue removal: take whichever of the first bucket's top and the top of the spilled heap
+// comes first.
+static void *bucket_pop(priority_queue_t *queue)
+{
+	struct queue_bucket *bucket = bucket_first(queue);
+
+	queue->size--;
+	if (bucket && (queue->spilled == 0 || !queue->cmpfn(bucket->buffer[0], queue->buffer[0])))
+	{
+		return heap_pop(bucket->buffer, &bucket->size, queue->cmpfn);
+	}
+
+	return heap_pop(queue->buffer, &queue->spilled, queue->cmpfn);
+}
+
+static priority_queue_t *queue_alloc(char (*cmp)(void *, void *))
+{
+	priority_queue_t *queue;
+
+	queue = malloc(sizeof(priority_queue_t));
+
+	queue->buffer = malloc(INITIAL_SIZE * sizeof(void*));
+	queue->max_size = INITIAL_SIZE;
+	queue->size = 0;
+	queue->cmpfn = cmp;
+	queue->keyfn = NULL;
+	queue->buckets = NULL;
+	queue->nbuckets = 0;
+	queue->base = 0;
+	queue->spilled = 0;
+
+	return queue;
+}
+
+// Create a new priority queue
+priority_queue_t *queue_create(char (*cmp)(void *, void *))
+{
+	return queue_alloc(cmp);
+}
+
+// Create a new bucket queue
+priority_queue_t *queue_create_buckets(char (*cmp)(void *, void *), long (*key)(void *))
+{
+	priority_queue_t *queue = queue_alloc(cmp);
+
+	queue->keyfn = key;
+	queue->nbuckets = INITIAL_BUCKETS;
+	queue->buckets = calloc(queue->nbuckets, sizeof(struct queue_bucket));
+
+	return queue;
+}
+
+// Delete the priority queue
+void queue_delete(priority_queue_t *queue)
+{
+	for (size_t i = 0; i < queue->nbuckets; i++)
+	{
+		free(queue->buckets[i].buffer);
+	}
+	free(queue->buckets);
+
+	queue->size = -1;
+	queue->max_size = -1;
+	free(queue->buffer);
+}
+
+// Insert a new element in the queue and then sort its contents.
+void queue_push(priority_queue_t *queue, void* new_element)
+{
+	if (queue->keyfn)
+	{
+		bucket_push(queue, new_element);
+		return;
+	}
+
+	heap_push(&queue->buffer, &queue->size, &queue->max_size, INITIAL_SIZE, new_element, queue->cmpfn);
+}
+
+// Return the element with the lowest value in the queue, after removing it.
+void* queue_pop(priority_queue_t *queue)
+{
+	if (queue->size == 0)
+		return NULL;
+
+	if (queue->keyfn)
+	{
+		return bucket_pop(queue);
+	}
+
+	return heap_pop(queue->buffer, &queue->size, queue->cmpfn);
+}
+
+void* queue_top(priority_queue_t *queue)
+{
+	if (queue->size == 0)
+		return NULL;
+
+	if (queue->keyfn)
+	{
+		struct queue_bucket *bucket = bucket_first(queue);
+		if (bucket && (queue->spilled == 0 || !queue->cmpfn(bucket->buffer[0], queue->buffer[0])))
+		{
+			return bucket->buffer[0];
+		}
+	}
+
+	return queue->buffer[0];
+}
+
+// Remove every element that does not come strictly before threshold.
+void queue_prune(priority_queue_t *queue, void *threshold, void (*destructor)(void *))
+{
+	if (queue->keyfn)
+	{
+		queue->size = 0;
+		for (size_t i = 0; i < queue->nbuckets; i++)
+		{
+			struct queue_bucket *bucket = queue->buckets + i;
+			bucket->size = heap_prune(bucket->buffer, bucket->size, threshold, destructor, queue->cmpfn);
+			queue->size += bucket->size;
+		}
+		queue->spilled = heap_prune(queue->buffer, queue->spilled, threshold, destructor, queue->cmpfn);
+		queue->size += queue->spilled;
+		return;
+	}
+
+	queue->size = heap_prune(queue->buffer, queue->size, threshold, destructor, queue->cmpfn);
+
+	// Give memory back once most of the buffer is unused
+	if (queue->max_size > INITIAL_SIZE && queue->size < queue->max_size / 4)
+	{
+		queue->max_size /= 2;
+		while (queue->max_size > INITIAL_SIZE && queue->size < queue->max_size / 4)
+		{
+			queue->max_size /= 2;
+		}
+		queue->buffer = realloc(queue->buffer, queue->max_size * sizeof(void*));
+	}
+}
+
+// Duplicate queue
+priority_queue_t *queue_duplicate(priority_queue_t* queue)
+{
+	priority_queue_t *other;
+	other = malloc(sizeof(priority_queue_t));
+	*other = *queue;
+	other->buffer = malloc(queue->max_size * sizeof(void*));
+	memcpy(other->buffer, queue->buffer, queue->max_size * sizeof(void*));
+
+	if (queue->buckets)
+	{
+		other->buckets = calloc(queue->nbuckets, sizeof(struct queue_bucket));
+		for (size_t i = 0; i < queue->nbuckets; i++)
+		{
+			struct queue_bucket *from = queue->buckets + i, *to = other->buckets + i;
+			if (from->size > 0)
+			{
+				*to = *from;
+				to->buffer = malloc(from->max_size * sizeof(void*));
+				memcpy(to->buffer, from->buffer, from->size * sizeof(void*));
+			}
+		}
+	}
+
+	return other;
+}
+
+// Print the contents of the priority queue
+void queue_print(priority_queue_t* queue, FILE *fp,
+		 void (*print_node)(FILE *, void*))
+{
+	priority_queue_t *queue_copy = queue_duplicate(queue);
+	
+	while (queue_copy->size > 0)
+	{
+		void* node = queue_pop(queue_copy);
+		print_node(fp, node);
+	}
+
+	queue_delete(queue_copy);
+	free(queue_copy);
+}
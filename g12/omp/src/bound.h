@@ -0,0 +1,40 @@
+/*
+    Held-Karp lower bound: minimum 1-trees with Lagrangian penalties on the cities.
+
+    For a node whose path runs from 0 to here, whatever is left of the tour is a path from here
+    through every unvisited city back to 0. Its cost is at least a spanning tree over the unvisited
+    cities plus one edge from each end of the path into them. Adding a penalty pi[c] to every edge
+    at c and subtracting 2 * pi[c] leaves the cost of any tour unchanged, so the penalties are moved
+    (by subgradient steps) towards giving every unvisited city degree 2 in the tree.
+
+    Penalties are kept per node, as floats in the node's extra bytes, and a child starts its ascent
+    from its parent's. The extra bytes also keep the node's half-sum bound, which is what the delta
+    table builds on; node->bound is the larger of the two.
+*/
+
+#pragma once
+#include <stdint.h>
+
+#include "node.h"
+#include "repr.h"
+
+typedef struct tsp_bound tsp_bound;
+
+// Scratch space for one thread
+tsp_bound *tsp_bound_create(tsp_repr rep);
+void tsp_bound_delete(tsp_bound *bound);
+
+// Bytes of penalties every node carries (to pass to tsp_pool_init)
+size_t tsp_bound_extra(unsigned int ncities);
+
+// The half-sum bound of a node, to extend with the delta table
+double tsp_bound_halfsum(const tsp_node *node);
+
+// Run the ascent at the root, whose penalties start from zero, and return its bound.
+// root->bound has to be the half-sum bound on entry.
+double tsp_bound_root(tsp_bound *bound, tsp_node *root, double upper);
+
+// Bound for child, starting from the penalties of parent. child->bound has to be its half-sum
+// bound on entry. The ascent stops early once the bound goes above upper, as the child is then
+// pruned anyway.
+double tsp_bound_child(tsp_bound *bound, const tsp_node *parent, tsp_node *child, double upper);
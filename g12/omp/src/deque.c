@@ -0,0 +1,108 @@
+#include "deque.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+
+struct tsp_deque
+{
+    // Thieves hammer on top, the owner on bottom, so each gets a cache line of its own
+    alignas(64) atomic_long top;
+    alignas(64) atomic_long bottom;
+    alignas(64) _Atomic(tsp_node *) slots[TSP_DEQUE_SIZE];
+};
+
+tsp_deque *tsp_deque_create(void)
+{
+    tsp_deque *deque = aligned_alloc(alignof(tsp_deque), sizeof(tsp_deque));
+    if (!deque)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    for (size_t i = 0; i < TSP_DEQUE_SIZE; i++)
+    {
+        atomic_init(deque->slots + i, NULL);
+    }
+    return deque;
+}
+
+void tsp_deque_delete(tsp_deque *deque)
+{
+    free(deque);
+}
+
+bool tsp_deque_push(tsp_deque *deque, tsp_node *node)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (b - t >= TSP_DEQUE_SIZE)
+    {
+        return false;
+    }
+    atomic_store_explicit(deque->slots + b % TSP_DEQUE_SIZE, node, memory_order_relaxed);
+    // The node has to be in its slot before any thief can see the new bottom
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+tsp_node *tsp_deque_pop(tsp_deque *deque)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    // Claim the bottom slot before looking at how far the thieves got
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    tsp_node *node = NULL;
+    if (t <= b)
+    {
+        node = atomic_load_explicit(deque->slots + b % TSP_DEQUE_SIZE, memory_order_relaxed);
+        if (t == b)
+        {
+            // The last node: whoever moves top past it gets it
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            {
+                node = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return node;
+}
+
+tsp_node *tsp_deque_steal(tsp_deque *deque)
+{
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b)
+    {
+        return NULL;
+    }
+
+    tsp_node *node = atomic_load_explicit(deque->slots + t % TSP_DEQUE_SIZE, memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+    {
+        // The owner or another thief took it
+        return NULL;
+    }
+    return node;
+}
+
+size_t tsp_deque_size(tsp_deque *deque)
+{
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    return b > t ? (size_t)(b - t) : 0;
+}
@@ -0,0 +1,31 @@
+/*
+    A bounded work-stealing deque of nodes (Chase and Lev, with the C11 memory orders of Lê et al.).
+    Only its owner pushes and pops, at the bottom; any other thread may steal from the top. Neither
+    end takes a lock: the only contended step is a compare-and-swap on the top when two threads go
+    for the same last node.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "node.h"
+
+// Room in every deque; pushing more than this fails rather than growing
+#define TSP_DEQUE_SIZE 64
+
+typedef struct tsp_deque tsp_deque;
+
+tsp_deque *tsp_deque_create(void);
+void tsp_deque_delete(tsp_deque *deque);
+
+// Owner only. Returns false, leaving node with the caller, when the deque is full.
+bool tsp_deque_push(tsp_deque *deque, tsp_node *node);
+// Owner only. The node pushed last, or NULL when the deque is empty.
+tsp_node *tsp_deque_pop(tsp_deque *deque);
+
+// Any thread. The node pushed first, or NULL when the deque is empty or another thread got it first.
+tsp_node *tsp_deque_steal(tsp_deque *deque);
+
+// Any thread. How many nodes were in the deque a moment ago.
+size_t tsp_deque_size(tsp_deque *deque);
@@ -0,0 +1,179 @@
+#include "dominance.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "debug.h"
+
+#ifdef _OPENMP
+#define SHARDS 64
+#else
+#define SHARDS 1
+#endif
+
+// A slot is laid out as: tag (0 when empty), last and second city, cost, then the visited words
+#define SLOT_HEADER 3
+
+typedef struct
+{
+#ifdef _OPENMP
+    omp_lock_t lock;
+#endif
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long pruned;
+    // Keep shards that different threads hammer on apart
+    char pad[64];
+} shard;
+
+struct tsp_dominance
+{
+    unsigned int words;
+    bool symmetry;
+    size_t stride;
+    size_t mask;
+    uint64_t *slots;
+    shard shards[SHARDS];
+};
+
+tsp_dominance *tsp_dominance_create(unsigned int ncities, size_t megabytes, bool symmetry)
+{
+    tsp_dominance *table = calloc(1, sizeof(tsp_dominance));
+    table->words = TSP_SET_WORDS(ncities);
+    table->symmetry = symmetry;
+    table->stride = SLOT_HEADER + table->words;
+
+    // The largest power of two worth of slots that fits, but never fewer than one per shard
+    size_t slots = SHARDS;
+    while (2 * slots * table->stride * sizeof(uint64_t) <= megabytes << 20)
+    {
+        slots *= 2;
+    }
+    table->mask = slots - 1;
+    table->slots = calloc(slots * table->stride, sizeof(uint64_t));
+    if (!table->slots)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+
+#ifdef _OPENMP
+    for (int s = 0; s < SHARDS; s++)
+    {
+        omp_init_lock(&table->shards[s].lock);
+    }
+#endif
+    return table;
+}
+
+void tsp_dominance_delete(tsp_dominance *table)
+{
+#ifdef _OPENMP
+    for (int s = 0; s < SHARDS; s++)
+    {
+        omp_destroy_lock(&table->shards[s].lock);
+    }
+#endif
+    free(table->slots);
+    free(table);
+}
+
+// The cities that, with the visited set, make up the key of node
+static uint64_t node_cities(const tsp_dominance *table, const tsp_node *node)
+{
+    uint64_t second = table->symmetry && node->length > 1 ? tsp_node_second(node) : 0;
+    return node->index | second << 32;
+}
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t node_hash(const tsp_dominance *table, const tsp_node *node, uint64_t cities)
+{
+    const uint64_t *visited = tsp_node_visited(node);
+    uint64_t h = mix(cities);
+    for (unsigned int w = 0; w < table->words; w++)
+    {
+        h = mix(h ^ visited[w]);
+    }
+    // Never 0, which marks an empty slot
+    return h | 1;
+}
+
+// Look node up, recording it when record is set and nothing cheaper is there. Returns whether it is dominated.
+static bool lookup(tsp_dominance *table, const tsp_node *node, bool record)
+{
+    uint64_t cities = node_cities(table, node);
+    uint64_t tag = node_hash(table, node, cities);
+    size_t index = (tag >> 1) & table->mask;
+    uint64_t *slot = table->slots + index * table->stride;
+    shard *s = table->shards + index % SHARDS;
+    size_t setsize = table->words * sizeof(uint64_t);
+    bool dominated = false;
+
+#ifdef _OPENMP
+    omp_set_lock(&s->lock);
+#endif
+    s->lookups++;
+    if (slot[0] == tag && slot[1] == cities && memcmp(slot + SLOT_HEADER, tsp_node_visited(node), setsize) == 0)
+    {
+        double best;
+        memcpy(&best, slot + 2, sizeof(double));
+        s->hits++;
+        dominated = best < node->cost;
+        if (record && node->cost < best)
+        {
+            memcpy(slot + 2, &node->cost, sizeof(double));
+        }
+    }
+    else if (record)
+    {
+        slot[0] = tag;
+        slot[1] = cities;
+        memcpy(slot + 2, &node->cost, sizeof(double));
+        memcpy(slot + SLOT_HEADER, tsp_node_visited(node), setsize);
+    }
+    if (dominated)
+    {
+        s->pruned++;
+    }
+#ifdef _OPENMP
+    omp_unset_lock(&s->lock);
+#endif
+
+    return dominated;
+}
+
+bool tsp_dominance_insert(tsp_dominance *table, const tsp_node *node)
+{
+    return lookup(table, node, true);
+}
+
+bool tsp_dominance_stale(tsp_dominance *table, const tsp_node *node)
+{
+    return lookup(table, node, false);
+}
+
+tsp_dominance_stats tsp_dominance_stats_of(const tsp_dominance *table)
+{
+    tsp_dominance_stats stats = {0};
+    stats.slots = table->mask + 1;
+    stats.bytes = stats.slots * table->stride * sizeof(uint64_t);
+    for (int s = 0; s < SHARDS; s++)
+    {
+        stats.lookups += table->shards[s].lookups;
+        stats.hits += table->shards[s].hits;
+        stats.pruned += table->shards[s].pruned;
+    }
+    return stats;
+}
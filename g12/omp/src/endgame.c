@@ -0,0 +1,261 @@
+#include "endgame.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "heuristic.h"
+
+// Entries in the memo table (24 bytes each)
+#define MEMO_SIZE (1 << 18)
+// Marks a memo entry that only holds a lower bound
+#define NO_NEXT UINT_MAX
+
+typedef struct
+{
+    // Cities still to visit (0 when the entry is empty; sets of fewer than two cities are never kept)
+    uint64_t set;
+    unsigned int city;
+    // The city to go to next on the cheapest completion, or NO_NEXT
+    unsigned int next;
+    // The cost of that completion, or a lower bound on it
+    double value;
+} memo_entry;
+
+struct tsp_endgame
+{
+    unsigned int ncities;
+    unsigned int k;
+    const double *graph;
+    const double *delta;
+    memo_entry *memo;
+    // Completions of the node solved last, not handed out yet
+    tsp_node **done;
+    unsigned int ndone;
+    unsigned int capacity;
+    tsp_endgame_stats stats;
+};
+
+tsp_endgame *tsp_endgame_create(tsp_repr rep, unsigned int k)
+{
+    if (rep.ncities > 64)
+    {
+        warn("The endgame only handles up to 64 cities; going without.\n");
+        return NULL;
+    }
+
+    tsp_endgame *endgame = malloc(sizeof(tsp_endgame));
+    endgame->ncities = rep.ncities;
+    endgame->k = k;
+    endgame->graph = rep.graph;
+    endgame->delta = rep.delta;
+    endgame->memo = calloc(MEMO_SIZE, sizeof(memo_entry));
+    endgame->capacity = 16;
+    endgame->ndone = 0;
+    endgame->done = malloc(endgame->capacity * sizeof(tsp_node *));
+    if (!endgame->memo || !endgame->done)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    endgame->stats = (tsp_endgame_stats){0};
+    return endgame;
+}
+
+void tsp_endgame_delete(tsp_endgame *endgame)
+{
+    while (endgame->ndone)
+    {
+        tsp_delnode(endgame->done[--endgame->ndone]);
+    }
+    free(endgame->done);
+    free(endgame->memo);
+    free(endgame);
+}
+
+bool tsp_endgame_covers(const tsp_endgame *endgame, const tsp_node *node)
+{
+    return node->length < endgame->ncities && endgame->ncities - node->length <= endgame->k;
+}
+
+static memo_entry *memo_slot(tsp_endgame *endgame, uint64_t set, unsigned int city)
+{
+    // splitmix64 finalizer
+    uint64_t x = set * 64 + city;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return endgame->memo + (x & (MEMO_SIZE - 1));
+}
+
+/*
+    The cost of going from city through every city in set and back to 0. It is exact (and exact is
+    set) when it comes to at most limit; otherwise it is only some lower bound above limit. rest is
+    a lower bound on that cost, as carried over from the half-sum bound of the node being solved.
+*/
+static double solve(tsp_endgame *endgame, uint64_t set, unsigned int city, double limit, double rest, bool *exact)
+{
+    const unsigned int n = endgame->ncities;
+    const double *graph = endgame->graph;
+
+    *exact = true;
+    if (set == 0)
+    {
+        return graph[city * n];
+    }
+    if ((set & (set - 1)) == 0)
+    {
+        unsigned int last = __builtin_ctzll(set);
+        return graph[city * n + last] + graph[last * n];
+    }
+
+    memo_entry *entry = memo_slot(endgame, set, city);
+    endgame->stats.lookups++;
+    if (entry->set == set && entry->city == city && (entry->next != NO_NEXT || entry->value > limit))
+    {
+        endgame->stats.hits++;
+        // A completion worked out under a looser limit is still only a lower bound under this one
+        *exact = entry->next != NO_NEXT && entry->value <= limit;
+        return entry->value;
+    }
+
+    const double *delta = endgame->delta + city * n;
+    double best = INFINITY, low = INFINITY;
+    unsigned int next = NO_NEXT;
+    for (uint64_t left = set; left; left &= left - 1)
+    {
+        unsigned int c = __builtin_ctzll(left);
+        double cap = best < limit ? best : limit;
+        // Same as bounding the child in the main search
+        if (rest + delta[c] > cap)
+        {
+            low = rest + delta[c] < low ? rest + delta[c] : low;
+            continue;
+        }
+
+        // Bounds that land right on the limit can come back a rounding error either side of it, so
+        // only exact answers are ever taken for a completion
+        bool known;
+        double w = graph[city * n + c];
+        double sub = w + solve(endgame, set & ~((uint64_t)1 << c), c, cap - w, rest + delta[c] - w, &known);
+        if (known && sub < best)
+        {
+            best = sub;
+            next = c;
+        }
+        else if (!known)
+        {
+            low = sub < low ? sub : low;
+        }
+    }
+
+    *exact = next != NO_NEXT && best <= limit;
+    entry->set = set;
+    entry->city = city;
+    entry->next = *exact ? next : NO_NEXT;
+    entry->value = *exact ? best : (best < low ? best : low);
+    return entry->value;
+}
+
+static void keep(tsp_endgame *endgame, tsp_node *complete)
+{
+    if (endgame->ndone == endgame->capacity)
+    {
+        endgame->capacity *= 2;
+        endgame->done = realloc(endgame->done, endgame->capacity * sizeof(tsp_node *));
+        if (!endgame->done)
+        {
+            error("Failed to allocate memory; aborting!\n");
+            exit(1);
+        }
+    }
+    endgame->done[endgame->ndone++] = complete;
+}
+
+/*
+    Build every completion of node through set that comes within slack of target, the cheapest cost
+    of closing the tour from node, and that keeps to limit (give or take rounding). The nodes are
+    built as the main search would have built them: the same sums in the same order, cut on the same
+    half-sum bound, so that it is left to weigh tours that only cost the same once rounded. Returns
+    whether node itself was kept.
+*/
+static bool collect(tsp_endgame *endgame, tsp_node *node, uint64_t set, double bound, double target, double limit)
+{
+    const unsigned int n = endgame->ncities;
+    const double *graph = endgame->graph;
+    unsigned int city = node->index;
+
+    if (set == 0)
+    {
+        // Over the limit by no more than rounding, the tour may still make it summed the other way round
+        double cost = node->cost + graph[city * n];
+        if (cost > limit + TSP_COST_SLACK(limit))
+        {
+            return false;
+        }
+        node->bound = cost;
+        keep(endgame, node);
+        return true;
+    }
+
+    const double *delta = endgame->delta + city * n;
+    const double slack = TSP_COST_SLACK(limit);
+    for (uint64_t left = set; left; left &= left - 1)
+    {
+        unsigned int c = __builtin_ctzll(left);
+        double w = graph[city * n + c];
+        if (bound + delta[c] > limit)
+        {
+            continue;
+        }
+
+        bool known;
+        uint64_t rest = set & ~((uint64_t)1 << c);
+        double sub = solve(endgame, rest, c, target - w + slack, bound + delta[c] - node->cost - w, &known);
+        if (!known || w + sub > target + slack)
+        {
+            continue;
+        }
+
+        tsp_node *child = tsp_node_child(node, c);
+        child->cost = node->cost + w;
+        if (!collect(endgame, child, rest, bound + delta[c], sub, limit))
+        {
+            tsp_delnode(child);
+        }
+    }
+    return false;
+}
+
+unsigned int tsp_endgame_solve(tsp_endgame *endgame, tsp_node *node, double base, double limit)
+{
+    uint64_t set = ~tsp_node_visited(node)[0];
+
+    endgame->stats.solved++;
+    // Added up the other way round, a tour right on the limit can come out just over it here
+    bool exact;
+    double cost = solve(endgame, set, node->index, limit - node->cost + TSP_COST_SLACK(limit), base - node->cost, &exact);
+    if (!exact)
+    {
+        return 0;
+    }
+
+    collect(endgame, node, set, base, cost, limit);
+    if (endgame->ndone)
+    {
+        endgame->stats.completed++;
+    }
+    return endgame->ndone;
+}
+
+tsp_node *tsp_endgame_next(tsp_endgame *endgame)
+{
+    return endgame->ndone ? endgame->done[--endgame->ndone] : NULL;
+}
+
+tsp_endgame_stats tsp_endgame_stats_of(const tsp_endgame *endgame)
+{
+    return endgame->stats;
+}
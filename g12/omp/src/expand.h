@@ -0,0 +1,26 @@
+/*
+    Child bounding for node expansion. A whole row of the delta table is bounded at once and only
+    the children worth pushing come out, in increasing city order.
+    The kernel is picked at run time: AVX-512, AVX2 or plain C, whichever the CPU supports.
+    Cities with few edges are walked through their neighbour list instead, cheapest first, up to the
+    first one over the threshold.
+*/
+
+#pragma once
+#include <stdint.h>
+
+#include "repr.h"
+
+// Pick the kernel for this CPU. Call once, before any thread expands a node.
+void tsp_expand_init(void);
+
+// For every city not in visited with delta[city] finite and bound + delta[city] <= threshold,
+// append the city to cities and its bound to bounds. Returns how many were written.
+// Both outputs need room for ncities entries.
+unsigned int tsp_expand(const double *delta, const uint64_t *visited, unsigned int ncities,
+                        double bound, double threshold, unsigned int *cities, double *bounds);
+
+// Same as tsp_expand, for the row of city: through its neighbour list when it is sparse enough for
+// that to beat the kernel over the whole row. Children still come out in increasing city order.
+unsigned int tsp_expand_city(const tsp_repr *rep, unsigned int city, const uint64_t *visited,
+                             double bound, double threshold, unsigned int *cities, double *bounds);
@@ -0,0 +1,196 @@
+#include "heuristic.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matrix.h"
+
+// Partial tours the nearest neighbour construction may try before it gives up
+#define NN_BUDGET (1L << 20)
+
+// Longest segment Or-opt moves around
+#define OROPT_MAX 3
+
+// Moves have to gain at least this much, so rounding noise cannot make the local search cycle
+#define EPSILON 1e-9
+
+#define D(a, b) matrix_read(rep.graph, rep.ncities, (a), (b))
+
+// Extend tour[0...depth-1] greedily, falling back to the next nearest city whenever a choice leads
+// nowhere. Returns whether a closed tour was found before the budget ran out.
+static bool nn_extend(tsp_repr rep, unsigned int *tour, bool *used, unsigned int depth, long *budget)
+{
+    const unsigned int n = rep.ncities;
+    if (depth == n)
+    {
+        return D(tour[n - 1], 0) != INFINITY;
+    }
+    if ((*budget)-- <= 0)
+    {
+        return false;
+    }
+
+    unsigned int here = tour[depth - 1];
+    double lastcost = -INFINITY;
+    unsigned int lastcity = 0;
+
+    for (;;)
+    {
+        // The nearest city after the last one tried, in (cost, city) order
+        unsigned int best = n;
+        double bestcost = INFINITY;
+        for (unsigned int c = 0; c < n; c++)
+        {
+            double d = D(here, c);
+            if (used[c] || d == INFINITY || d < lastcost || (d == lastcost && c <= lastcity))
+            {
+                continue;
+            }
+            if (d < bestcost)
+            {
+                best = c;
+                bestcost = d;
+            }
+        }
+        if (best == n)
+        {
+            return false;
+        }
+
+        lastcost = bestcost;
+        lastcity = best;
+        used[best] = true;
+        tour[depth] = best;
+        if (nn_extend(rep, tour, used, depth + 1, budget))
+        {
+            return true;
+        }
+        used[best] = false;
+
+        if (*budget <= 0)
+        {
+            return false;
+        }
+    }
+}
+
+// One sweep of 2-opt: replace edges (a, b) and (c, e) by (a, c) and (b, e) by reversing b...c
+static bool two_opt(tsp_repr rep, unsigned int *tour)
+{
+    const unsigned int n = rep.ncities;
+    bool improved = false;
+
+    for (unsigned int i = 0; i + 2 < n; i++)
+    {
+        for (unsigned int j = i + 2; j < n; j++)
+        {
+            unsigned int a = tour[i], b = tour[i + 1], c = tour[j], e = tour[(j + 1) % n];
+            if (e == a)
+            {
+                continue;
+            }
+
+            if (D(a, c) + D(b, e) - D(a, b) - D(c, e) < -EPSILON)
+            {
+                for (unsigned int lo = i + 1, hi = j; lo < hi; lo++, hi--)
+                {
+                    unsigned int swap = tour[lo];
+                    tour[lo] = tour[hi];
+                    tour[hi] = swap;
+                }
+                improved = true;
+            }
+        }
+    }
+
+    return improved;
+}
+
+// One sweep of Or-opt: move a segment of up to OROPT_MAX cities (possibly reversed) between two
+// other adjacent cities. City 0 never moves, so the tour keeps starting there.
+static bool or_opt(tsp_repr rep, unsigned int *tour, unsigned int *scratch)
+{
+    const unsigned int n = rep.ncities;
+    bool improved = false;
+
+    for (unsigned int len = 1; len <= OROPT_MAX && len + 2 < n; len++)
+    {
+        for (unsigned int i = 1; i + len <= n; i++)
+        {
+            unsigned int first = tour[i], last = tour[i + len - 1];
+            unsigned int p = tour[i - 1], q = tour[(i + len) % n];
+            double gain = D(p, first) + D(last, q) - D(p, q);
+
+            for (unsigned int j = 0; j < n; j++)
+            {
+                // Edges touching the segment are not places it can go
+                if (j + 1 >= i && j < i + len)
+                {
+                    continue;
+                }
+
+                unsigned int a = tour[j], b = tour[(j + 1) % n];
+                double forward = D(a, first) + D(last, b) - D(a, b);
+                double backward = D(a, last) + D(first, b) - D(a, b);
+                bool reverse = backward < forward;
+                if ((reverse ? backward : forward) - gain >= -EPSILON)
+                {
+                    continue;
+                }
+
+                unsigned int k = 0;
+                for (unsigned int at = 0; at < n; at++)
+                {
+                    if (at >= i && at < i + len)
+                    {
+                        continue;
+                    }
+                    scratch[k++] = tour[at];
+                    if (at == j)
+                    {
+                        for (unsigned int s = 0; s < len; s++)
+                        {
+                            scratch[k++] = tour[reverse ? i + len - 1 - s : i + s];
+                        }
+                    }
+                }
+                memcpy(tour, scratch, n * sizeof(unsigned int));
+                improved = true;
+                break;
+            }
+        }
+    }
+
+    return improved;
+}
+
+double tsp_heuristic(tsp_repr rep, unsigned int *tour)
+{
+    const unsigned int n = rep.ncities;
+    bool *used = calloc(n, sizeof(bool));
+    long budget = NN_BUDGET;
+
+    tour[0] = 0;
+    used[0] = true;
+    bool found = n == 1 || nn_extend(rep, tour, used, 1, &budget);
+    free(used);
+    if (!found)
+    {
+        return INFINITY;
+    }
+
+    unsigned int *scratch = malloc(n * sizeof(unsigned int));
+    while (two_opt(rep, tour) || or_opt(rep, tour, scratch))
+    {
+    }
+    free(scratch);
+
+    // Same order of additions as the search, so an equal tour comes out at an equal cost
+    double cost = 0;
+    for (unsigned int i = 1; i < n; i++)
+    {
+        cost += D(tour[i - 1], tour[i]);
+    }
+    return cost + D(tour[n - 1], 0);
+}
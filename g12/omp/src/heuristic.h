@@ -0,0 +1,18 @@
+/*
+    A quick feasible tour to seed the search with: nearest neighbour (backtracking out of dead ends
+    on sparse graphs), then 2-opt and Or-opt until neither finds an improvement.
+*/
+
+#pragma once
+#include <math.h>
+
+#include "repr.h"
+
+// Input costs have a single decimal digit, so two different tour costs are at least this far apart
+#define TSP_COST_STEP 0.1
+// Sums of the same costs, added up in another order, come out no further apart than this
+#define TSP_COST_SLACK(cost) (1e-9 * (1 + fabs(cost)))
+
+// Write a tour starting at city 0 into tour[0...ncities-1] and return its cost.
+// Returns INFINITY (tour is then meaningless) when no tour turned up within the search budget.
+double tsp_heuristic(tsp_repr rep, unsigned int *tour);
@@ -0,0 +1,279 @@
+#include "node.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "debug.h"
+
+// Every slab holds at least this many bytes worth of nodes
+#define SLAB_SIZE (1 << 16)
+
+typedef struct slab
+{
+    struct slab *next;
+} slab;
+
+// Free nodes are chained through their own storage
+typedef struct free_node
+{
+    struct free_node *next;
+} free_node;
+
+typedef struct
+{
+    free_node *free;
+    char *cursor;
+    char *end;
+} size_class;
+
+typedef struct
+{
+    size_class *classes;
+    unsigned int nclasses;
+    unsigned int ncities;
+    unsigned int words;
+    size_t extra;
+    slab *slabs;
+} tsp_pool;
+
+static _Thread_local tsp_pool pool;
+
+#if TSP_PREFIX
+// Every node has the same size, so a single class is enough
+#define NODE_CLASS(length) 0
+#else
+#define NODE_CLASS(length) (length)
+#endif
+
+size_t tsp_node_size(unsigned int length)
+{
+#if TSP_PREFIX
+    (void)length;
+    return sizeof(tsp_node) + pool.words * sizeof(uint64_t) + pool.extra;
+#else
+    // The tour is padded to an even length so that the visited words stay aligned
+    return sizeof(tsp_node) + ((length + 1) & ~1u) * sizeof(unsigned int) + pool.words * sizeof(uint64_t) + pool.extra;
+#endif
+}
+
+void tsp_pool_init(unsigned int ncities, size_t extra)
+{
+    pool.nclasses = ncities + 1;
+    pool.ncities = ncities;
+    pool.words = TSP_SET_WORDS(ncities);
+    // Keep whatever follows the extra bytes (the next node in the slab) 8-byte aligned
+    pool.extra = (extra + 7) & ~(size_t)7;
+    pool.classes = calloc(pool.nclasses, sizeof(size_class));
+    pool.slabs = NULL;
+}
+
+void tsp_pool_release(void)
+{
+    while (pool.slabs)
+    {
+        slab *next = pool.slabs->next;
+        free(pool.slabs);
+        pool.slabs = next;
+    }
+    free(pool.classes);
+    pool.classes = NULL;
+    pool.nclasses = 0;
+}
+
+// Grab a fresh slab and make it the bump region of the given class
+static void pool_refill(size_class *c, size_t size)
+{
+    size_t bytes = SLAB_SIZE > size ? SLAB_SIZE : size;
+    slab *s = malloc(sizeof(double) + bytes);
+    if (!s)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    s->next = pool.slabs;
+    pool.slabs = s;
+
+    c->cursor = (char *)s + sizeof(double);
+    c->end = c->cursor + (bytes / size) * size;
+}
+
+tsp_node *tsp_mknode(unsigned int length)
+{
+    size_class *c = pool.classes + NODE_CLASS(length);
+    tsp_node *node;
+
+    if (c->free)
+    {
+        node = (tsp_node *)c->free;
+        c->free = c->free->next;
+    }
+    else
+    {
+        size_t size = tsp_node_size(length);
+        if (c->cursor == c->end)
+        {
+            pool_refill(c, size);
+        }
+        node = (tsp_node *)c->cursor;
+        c->cursor += size;
+    }
+
+    node->length = length;
+    return node;
+}
+
+// Put a dead node back on the free list of its class
+static void pool_put(tsp_node *node)
+{
+    size_class *c = pool.classes + NODE_CLASS(node->length);
+    free_node *f = (free_node *)node;
+    f->next = c->free;
+    c->free = f;
+}
+
+#if TSP_PREFIX
+// Prefixes can be shared across threads, so the counts are updated atomically under OpenMP (tsp-omp
+// builds this file with -fopenmp; a tsp-mpi rank is a single thread)
+static void node_ref(tsp_node *node)
+{
+#ifdef _OPENMP
+#pragma omp atomic update
+#endif
+    node->refs++;
+}
+
+static unsigned int node_unref(tsp_node *node)
+{
+    unsigned int refs;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+    refs = --node->refs;
+    return refs;
+}
+
+void tsp_delnode(tsp_node *node)
+{
+    // Releasing the last child of a prefix releases the prefix too
+    while (node && node_unref(node) == 0)
+    {
+        tsp_node *parent = node->parent;
+        pool_put(node);
+        node = parent;
+    }
+}
+#else
+void tsp_delnode(tsp_node *node)
+{
+    pool_put(node);
+}
+#endif
+
+tsp_node *tsp_node_root(double bound)
+{
+    tsp_node *node = tsp_mknode(1);
+    uint64_t *visited = tsp_node_visited(node);
+
+    node->cost = 0;
+    node->bound = bound;
+    node->index = 0;
+#if TSP_PREFIX
+    node->parent = NULL;
+    node->refs = 1;
+    node->second = 0;
+#else
+    node->tour[0] = 0;
+#endif
+
+    for (unsigned int w = 0; w < pool.words; w++)
+    {
+        visited[w] = 0;
+    }
+    // Padding bits count as visited
+    if (pool.ncities % 64)
+    {
+        visited[pool.words - 1] = ~(uint64_t)0 << (pool.ncities % 64);
+    }
+    visited[0] |= 1;
+    memset(tsp_node_extra(node), 0, pool.extra);
+
+    return node;
+}
+
+tsp_node *tsp_node_child(tsp_node *parent, unsigned int city)
+{
+    tsp_node *node = tsp_mknode(parent->length + 1);
+    const uint64_t *from = tsp_node_visited(parent);
+    uint64_t *visited = tsp_node_visited(node);
+
+#if TSP_PREFIX
+    node_ref(parent);
+    node->parent = parent;
+    node->refs = 1;
+    node->second = parent->length == 1 ? city : parent->second;
+#else
+    memcpy(node->tour, parent->tour, parent->length * sizeof(unsigned int));
+    node->tour[parent->length] = city;
+#endif
+    node->index = city;
+
+    for (unsigned int w = 0; w < pool.words; w++)
+    {
+        visited[w] = from[w];
+    }
+    visited[city / 64] |= (uint64_t)1 << (city % 64);
+
+    return node;
+}
+
+void tsp_node_tour(const tsp_node *node, unsigned int *tour)
+{
+#if TSP_PREFIX
+    for (unsigned int i = node->length; i-- > 0; node = node->parent)
+    {
+        tour[i] = node->index;
+    }
+#else
+    memcpy(tour, node->tour, node->length * sizeof(unsigned int));
+#endif
+}
+
+// Wire format: cost, bound, length and index as laid out in tsp_node, then the tour, then the extra bytes
+#define PACK_HEADER (2 * sizeof(double) + 2 * sizeof(unsigned int))
+
+size_t tsp_node_packsize(unsigned int ncities)
+{
+    return PACK_HEADER + ncities * sizeof(unsigned int) + pool.extra;
+}
+
+void tsp_node_pack(const tsp_node *node, char *buffer)
+{
+    memcpy(buffer, node, PACK_HEADER);
+    tsp_node_tour(node, (unsigned int *)(buffer + PACK_HEADER));
+    memcpy(buffer + PACK_HEADER + node->length * sizeof(unsigned int), tsp_node_extra(node), pool.extra);
+}
+
+tsp_node *tsp_node_unpack(const char *buffer)
+{
+    const tsp_node *header = (const tsp_node *)buffer;
+    const unsigned int *tour = (const unsigned int *)(buffer + PACK_HEADER);
+
+    // Replay the tour from the root so that the visited set (and, with TSP_PREFIX, the parents) come for free
+    tsp_node *node = tsp_node_root(0);
+    for (unsigned int i = 1; i < header->length; i++)
+    {
+        tsp_node *next = tsp_node_child(node, tour[i]);
+        tsp_delnode(node);
+        node = next;
+    }
+    node->cost = header->cost;
+    node->bound = header->bound;
+    memcpy(tsp_node_extra(node), tour + header->length, pool.extra);
+
+    return node;
+}
+
+void *tsp_node_extra(const tsp_node *node)
+{
+    return tsp_node_visited(node) + pool.words;
+}
@@ -0,0 +1,79 @@
+#include "relabel.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "matrix.h"
+
+bool tsp_relabel(tsp_repr *rep, unsigned int *tour)
+{
+    const unsigned int n = rep->ncities;
+    unsigned int *label = malloc(n * sizeof(unsigned int));
+    unsigned int *number = malloc(n * sizeof(unsigned int));
+    bool *taken = calloc(n, sizeof(bool));
+    double *graph = matrix_alloc(n);
+    if (!label || !number || !taken || !graph)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        return false;
+    }
+
+    // Always on to the nearest city not numbered yet, or the lowest one when none is next door
+    label[0] = 0;
+    taken[0] = true;
+    for (unsigned int k = 1; k < n; k++)
+    {
+        unsigned int here = label[k - 1], next = n;
+        double nearest = INFINITY;
+        for (unsigned int c = 1; c < n; c++)
+        {
+            double edge = matrix_read(rep->graph, n, here, c);
+            if (!taken[c] && (next == n || edge < nearest))
+            {
+                next = c;
+                nearest = edge;
+            }
+        }
+        label[k] = next;
+        taken[next] = true;
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            matrix_write(graph, n, i, j, matrix_read(rep->graph, n, label[i], label[j]));
+        }
+    }
+    for (unsigned int i = 0; i < n; i++)
+    {
+        number[label[i]] = i;
+    }
+    for (unsigned int i = 0; i < n; i++)
+    {
+        // Leave whatever is not a city alone, as in a heuristic tour that never got filled in
+        if (tour[i] < n)
+        {
+            tour[i] = number[tour[i]];
+        }
+    }
+    free(number);
+    free(taken);
+    free(rep->graph);
+    rep->graph = graph;
+    rep->label = label;
+    return tsp_repr_refresh(rep);
+}
+
+void tsp_relabel_tour(tsp_repr rep, unsigned int *tour)
+{
+    for (unsigned int i = 0; i < rep.ncities; i++)
+    {
+        // Leave whatever is not a city alone, as in a tour that never got filled in
+        if (tour[i] < rep.ncities)
+        {
+            tour[i] = tsp_repr_label(rep, tour[i]);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+/*
+    City renumbering. The search tries children in city order and breaks ties on the lowest city,
+    so the numbers an input happens to give its cities change how soon good tours turn up. With
+    --relabel=nearest the cities are numbered along a nearest-neighbour chain from city 0 instead,
+    which also puts cities that follow each other on a tour next to each other in the matrix.
+
+    The search then weighs the tours it finds as the search on the input's numbers would have
+    (see tsp_mirror_key_of), and the tour is given back in the input's numbers, so the output stays
+    the same.
+*/
+
+#pragma once
+#include "repr.h"
+
+// Renumber the cities of rep (0 keeps its number), moving graph and everything worked out from it
+// over, and fill in rep->label. tour[0...ncities-1], a tour in the input's numbers, is renumbered
+// along with them. Returns false (and complains) if memory ran out.
+bool tsp_relabel(tsp_repr *rep, unsigned int *tour);
+
+// Turn tour[0...ncities-1] back into the input's numbers
+void tsp_relabel_tour(tsp_repr rep, unsigned int *tour);
@@ -0,0 +1,223 @@
+#include "repr.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "matrix.h"
+
+void tsp_delrepr(tsp_repr t)
+{
+    if (t.graph)
+    {
+        free(t.graph);
+    }
+    if (t.short1)
+    {
+        free(t.short1);
+    }
+    if (t.short2)
+    {
+        free(t.short2);
+    }
+    if (t.delta)
+    {
+        free(t.delta);
+    }
+    if (t.adjstart)
+    {
+        free(t.adjstart);
+    }
+    if (t.adjcity)
+    {
+        free(t.adjcity);
+    }
+    if (t.adjdelta)
+    {
+        free(t.adjdelta);
+    }
+    if (t.label)
+    {
+        free(t.label);
+    }
+}
+
+tsp_repr tsp_mkrepr(FILE *input)
+{
+    tsp_repr t;
+    t.graph = NULL;
+    t.short1 = NULL;
+    t.short2 = NULL;
+    t.delta = NULL;
+    t.adjstart = NULL;
+    t.adjcity = NULL;
+    t.adjdelta = NULL;
+    t.label = NULL;
+
+    int nroutes = -1;
+    int from = -1, to = -1;
+    double cost = -1;
+
+    if (fscanf(input, "%u %d", &(t.ncities), &nroutes) == 2)
+    {
+        t.graph = matrix_alloc(t.ncities);
+        t.short1 = array_alloc(t.ncities);
+        t.short2 = array_alloc(t.ncities);
+
+        if (!t.graph || !t.short1 || !t.short2)
+        {
+            error("Failed to allocate memory; aborting!\n");
+            t.valid = false;
+            return t;
+        }
+    }
+
+    for (int i = 0; i < nroutes; i++)
+    {
+        if (fscanf(input, "%d %d %lf", &from, &to, &cost) == 3)
+        {
+            matrix_write(t.graph, t.ncities, from, to, cost);
+            matrix_write(t.graph, t.ncities, to, from, cost);
+        }
+        else
+        {
+            error("Error reading file.\n");
+            t.valid = false;
+            return t;
+        }
+    }
+
+    fclose(input);
+
+    if (!t.graph)
+    {
+        error("Error reading file.\n");
+        t.valid = false;
+        return t;
+    }
+    t.valid = tsp_repr_refresh(&t);
+    return t;
+}
+
+bool tsp_repr_refresh(tsp_repr *t)
+{
+    const unsigned int n = t->ncities;
+    unsigned int edges = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        t->short1[i] = INFINITY;
+        t->short2[i] = INFINITY;
+        for (unsigned int j = 0; j < n; j++)
+        {
+            double edge = matrix_read(t->graph, n, i, j);
+            if (edge == INFINITY)
+            {
+                continue;
+            }
+            edges++;
+
+            if (t->short1[i] > edge)
+            {
+                t->short2[i] = t->short1[i];
+                t->short1[i] = edge;
+            }
+            else if (t->short2[i] > edge)
+            {
+                t->short2[i] = edge;
+            }
+        }
+    }
+
+    free(t->delta);
+    free(t->adjstart);
+    free(t->adjcity);
+    free(t->adjdelta);
+    t->delta = matrix_alloc(n);
+    t->adjstart = calloc(n + 1, sizeof(unsigned int));
+    t->adjcity = malloc((edges + 1) * sizeof(unsigned int));
+    t->adjdelta = malloc((edges + 1) * sizeof(double));
+    if (!t->delta || !t->adjstart || !t->adjcity || !t->adjdelta)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        return false;
+    }
+
+    // The bound drops half of the edges each endpoint was assumed to use and takes the real edge
+    // instead. That only depends on the edge, so it is worked out once here rather than per child.
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            double edge = matrix_read(t->graph, n, i, j);
+            if (edge == INFINITY)
+            {
+                continue;
+            }
+
+            double update = (edge >= t->short2[j] ? t->short2[j] : t->short1[j]) + (edge >= t->short2[i] ? t->short2[i] : t->short1[i]);
+            matrix_write(t->delta, n, i, j, edge - (update / 2));
+        }
+    }
+
+    edges = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        t->adjstart[i] = edges;
+        for (unsigned int j = 0; j < n; j++)
+        {
+            double d = matrix_read(t->delta, n, i, j);
+            if (d == INFINITY)
+            {
+                continue;
+            }
+
+            // Rows are short, so an insertion sort will do
+            unsigned int k = edges++;
+            while (k > t->adjstart[i] && t->adjdelta[k - 1] > d)
+            {
+                t->adjcity[k] = t->adjcity[k - 1];
+                t->adjdelta[k] = t->adjdelta[k - 1];
+                k--;
+            }
+            t->adjcity[k] = j;
+            t->adjdelta[k] = d;
+        }
+    }
+    t->adjstart[n] = edges;
+
+    return true;
+}
+
+// A fresh copy of bytes from from, or NULL if there is nothing to copy
+static void *copy_of(const void *from, size_t bytes)
+{
+    void *to = from ? malloc(bytes) : NULL;
+    if (to)
+    {
+        memcpy(to, from, bytes);
+    }
+    return to;
+}
+
+tsp_repr tsp_repr_copy(tsp_repr t)
+{
+    const size_t n = t.ncities;
+    const size_t edges = t.adjstart[n];
+    tsp_repr copy = t;
+    copy.graph = copy_of(t.graph, n * n * sizeof(double));
+    copy.short1 = copy_of(t.short1, n * sizeof(double));
+    copy.short2 = copy_of(t.short2, n * sizeof(double));
+    copy.delta = copy_of(t.delta, n * n * sizeof(double));
+    copy.adjstart = copy_of(t.adjstart, (n + 1) * sizeof(unsigned int));
+    copy.adjcity = copy_of(t.adjcity, (edges + 1) * sizeof(unsigned int));
+    copy.adjdelta = copy_of(t.adjdelta, (edges + 1) * sizeof(double));
+    copy.label = copy_of(t.label, n * sizeof(unsigned int));
+    if (!copy.graph || !copy.short1 || !copy.short2 || !copy.delta || !copy.adjstart || !copy.adjcity || !copy.adjdelta ||
+        (t.label && !copy.label))
+    {
+        error("Failed to allocate memory; aborting!\n");
+        copy.valid = false;
+    }
+    return copy;
+}
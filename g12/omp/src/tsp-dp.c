@@ -0,0 +1,379 @@
+/*
+    Held-Karp dynamic programming, as an alternative to branch and bound on small instances: the
+    cheapest path from 0 through every subset S of the other cities, ending at each city of S, is
+    built one subset size at a time, and every subset of a size is worked out in parallel.
+
+    Its time (2^n * n^2) and memory (2^n * n / 2 costs) only depend on n, so it takes whatever an
+    instance throws at it up to around 26 cities. Costs are kept as doubles, or as floats when built
+    with DPFLOAT=1 (half the memory; the tour found is then priced again in double).
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "debug.h"
+#include "matrix.h"
+#include "repr.h"
+
+#ifndef TSP_DP_FLOAT
+#define TSP_DP_FLOAT 0
+#endif
+
+#if TSP_DP_FLOAT
+typedef float dp_cost;
+#else
+typedef double dp_cost;
+#endif
+
+// Past this, the table would not fit in memory anyway
+#define TSP_DP_MAX 32
+// Subsets handed to a thread at a time
+#define CHUNK 1024
+
+typedef struct
+{
+    unsigned int *tour;
+    double cost;
+} tsp_result;
+
+/*
+    Cities 1...n-1 are numbered 0...m-1 in the subsets. The subsets of each size s are ranked in
+    colex order (which is also the order Gosper's hack walks them in), and each gets s costs in a
+    row, one for every city of the subset it can end on, in increasing city order.
+*/
+typedef struct
+{
+    unsigned int m;
+    // C(p, k) at binom[p * (m + 1) + k]
+    size_t *binom;
+    // Where the costs of subsets of size s start in table
+    size_t *layer;
+    dp_cost *table;
+    // Edge costs between cities 1...n-1, and from each of them to city 0
+    dp_cost *edge;
+    dp_cost *home;
+} tsp_dp;
+
+static size_t binom(const tsp_dp *dp, unsigned int p, unsigned int k)
+{
+    return k > p ? 0 : dp->binom[p * (dp->m + 1) + k];
+}
+
+// The subset of size s with the given colex rank
+static uint64_t unrank(const tsp_dp *dp, size_t rank, unsigned int s)
+{
+    uint64_t set = 0;
+    unsigned int p = dp->m;
+    for (unsigned int k = s; k > 0; k--)
+    {
+        while (binom(dp, p, k) > rank)
+        {
+            p--;
+        }
+        set |= (uint64_t)1 << p;
+        rank -= binom(dp, p, k);
+    }
+    return set;
+}
+
+// The next subset of the same size in colex order
+static uint64_t next_subset(uint64_t set)
+{
+    uint64_t low = set & -set;
+    uint64_t ripple = set + low;
+    return (((ripple ^ set) >> 2) / low) | ripple;
+}
+
+// The cities of set (of size s) into pos, and into without[t] the rank of set minus its t-th city
+static void subsets_within(const tsp_dp *dp, uint64_t set, unsigned int s, unsigned int *pos, size_t *without)
+{
+    unsigned int t = 0;
+    for (uint64_t left = set; left; left &= left - 1)
+    {
+        pos[t++] = __builtin_ctzll(left);
+    }
+
+    // Dropping the t-th city moves every later one down a place in the rank
+    size_t before = 0;
+    for (t = 0; t < s; t++)
+    {
+        size_t after = 0;
+        for (unsigned int k = t + 1; k < s; k++)
+        {
+            after += binom(dp, pos[k], k);
+        }
+        without[t] = before + after;
+        before += binom(dp, pos[t], t + 1);
+    }
+}
+
+// Fill in the cost of every ending city of set (of size s and rank rank)
+static void relax(tsp_dp *dp, uint64_t set, unsigned int s, size_t rank, unsigned int *pos, size_t *without)
+{
+    subsets_within(dp, set, s, pos, without);
+
+    dp_cost *row = dp->table + dp->layer[s] + rank * s;
+    for (unsigned int t = 0; t < s; t++)
+    {
+        const dp_cost *prev = dp->table + dp->layer[s - 1] + without[t] * (s - 1);
+        const dp_cost *to = dp->edge + pos[t];
+        dp_cost best = INFINITY;
+        for (unsigned int u = 0; u < s; u++)
+        {
+            if (u == t)
+            {
+                continue;
+            }
+            dp_cost cost = prev[u < t ? u : u - 1] + to[pos[u] * dp->m];
+            best = cost < best ? cost : best;
+        }
+        row[t] = best;
+    }
+}
+
+tsp_result tsp_exe(tsp_repr rep)
+{
+    unsigned int n = rep.ncities;
+    tsp_result result;
+    result.tour = calloc(n, sizeof(unsigned int));
+    result.cost = INFINITY;
+    if (n == 1)
+    {
+        // No edge leads from city 0 back to itself, so there is no tour, as the search finds too
+        return result;
+    }
+
+    tsp_dp dp;
+    unsigned int m = dp.m = n - 1;
+    dp.binom = calloc((m + 1) * (m + 1), sizeof(size_t));
+    for (unsigned int p = 0; p <= m; p++)
+    {
+        dp.binom[p * (m + 1)] = 1;
+        for (unsigned int k = 1; k <= p; k++)
+        {
+            dp.binom[p * (m + 1) + k] = dp.binom[(p - 1) * (m + 1) + k - 1] + (k < p ? dp.binom[(p - 1) * (m + 1) + k] : 0);
+        }
+    }
+    dp.layer = calloc(m + 2, sizeof(size_t));
+    for (unsigned int s = 1; s <= m; s++)
+    {
+        dp.layer[s + 1] = dp.layer[s] + binom(&dp, m, s) * s;
+    }
+    dp.edge = malloc(m * m * sizeof(dp_cost));
+    dp.home = malloc(m * sizeof(dp_cost));
+    for (unsigned int i = 0; i < m; i++)
+    {
+        for (unsigned int j = 0; j < m; j++)
+        {
+            dp.edge[i * m + j] = matrix_read(rep.graph, n, i + 1, j + 1);
+        }
+        dp.home[i] = matrix_read(rep.graph, n, i + 1, 0);
+    }
+
+    info("Held-Karp table: %.1f MiB of %s\n", dp.layer[m + 1] * sizeof(dp_cost) / 1048576.0, TSP_DP_FLOAT ? "floats" : "doubles");
+    dp.table = malloc(dp.layer[m + 1] * sizeof(dp_cost));
+    if (!dp.table)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+
+    // Paths through a single city come straight from 0
+    for (unsigned int p = 0; p < m; p++)
+    {
+        dp.table[dp.layer[1] + p] = dp.home[p];
+    }
+    for (unsigned int s = 2; s <= m; s++)
+    {
+        size_t count = binom(&dp, m, s);
+        size_t chunks = (count + CHUNK - 1) / CHUNK;
+#pragma omp parallel default(none) shared(dp, s, m, count, chunks)
+        {
+            unsigned int pos[TSP_DP_MAX];
+            size_t without[TSP_DP_MAX];
+#pragma omp for schedule(dynamic)
+            for (size_t c = 0; c < chunks; c++)
+            {
+                size_t end = (c + 1) * CHUNK < count ? (c + 1) * CHUNK : count;
+                uint64_t set = unrank(&dp, c * CHUNK, s);
+                for (size_t rank = c * CHUNK; rank < end; rank++)
+                {
+                    relax(&dp, set, s, rank, pos, without);
+                    set = next_subset(set);
+                }
+            }
+        }
+        debug("Layer %u done\n", s);
+    }
+
+    // Close the tour, then walk it back: the city before j is one whose path, plus the edge to j,
+    // gives exactly the cost kept for j
+    uint64_t set = ((uint64_t)1 << m) - 1;
+    unsigned int pos[TSP_DP_MAX];
+    size_t without[TSP_DP_MAX];
+    size_t rank = 0;
+    subsets_within(&dp, set, m, pos, without);
+
+    const dp_cost *row = dp.table + dp.layer[m];
+    dp_cost best = INFINITY;
+    unsigned int t = 0;
+    for (unsigned int u = 0; u < m; u++)
+    {
+        dp_cost cost = row[u] + dp.home[pos[u]];
+        if (cost < best)
+        {
+            best = cost;
+            t = u;
+        }
+    }
+
+    if (best != INFINITY)
+    {
+        for (unsigned int s = m; s > 0; s--)
+        {
+            unsigned int j = pos[t];
+            result.tour[s] = j + 1;
+            if (s == 1)
+            {
+                break;
+            }
+
+            dp_cost here = dp.table[dp.layer[s] + rank * s + t];
+            const dp_cost *prev = dp.table + dp.layer[s - 1] + without[t] * (s - 1);
+            unsigned int from = 0;
+            for (unsigned int u = 0; u < s; u++)
+            {
+                dp_cost cost = u == t ? INFINITY : prev[u < t ? u : u - 1] + dp.edge[pos[u] * m + j];
+                if (u != t && cost == here)
+                {
+                    from = u < t ? u : u - 1;
+                    break;
+                }
+            }
+
+            set &= ~((uint64_t)1 << j);
+            rank = without[t];
+            subsets_within(&dp, set, s - 1, pos, without);
+            t = from;
+        }
+
+        // Price the tour in double, adding up in the same order as the search does
+        result.cost = 0;
+        for (unsigned int i = 1; i < n; i++)
+        {
+            result.cost += matrix_read(rep.graph, n, result.tour[i - 1], result.tour[i]);
+        }
+        result.cost += matrix_read(rep.graph, n, result.tour[n - 1], 0);
+    }
+
+    free(dp.binom);
+    free(dp.layer);
+    free(dp.edge);
+    free(dp.home);
+    free(dp.table);
+    return result;
+}
+
+void help(char *me)
+{
+    printf("USAGE: %s inputfile lowerbound\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
+}
+
+int main(int argc, char *argv[])
+{
+    double limit = INFINITY;
+    double exec_time;
+
+    // Argument validation
+    if (argc <= 2)
+    {
+        error("No arguments provided.\n");
+        help(argv[0]);
+        return 1;
+    }
+    else if (argc > 3)
+    {
+        error("Too many arguments provided.\n");
+        help(argv[0]);
+        return 1;
+    }
+
+    // Make sure that the lowerbound arg is a number
+    if (atof(argv[2]) <= 0)
+    {
+        // Either the value is 0 (not allowed) or it is not a number.
+        // If that's the case ignore this.
+        warn("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
+    }
+    else
+    {
+        limit = (double)atof(argv[2]);
+    }
+    info("Cost must be <= %f\n", limit);
+    info("File target: %s\n", argv[1]);
+    FILE *input = fopen(argv[1], "r");
+    if (!input)
+    {
+        syserr("Could not open the input file");
+        return 1;
+    }
+
+    tsp_repr t = tsp_mkrepr(input);
+    if (!t.valid)
+    {
+        // An earlier error happened preventing us from carrying on
+        tsp_delrepr(t);
+        return 1;
+    }
+    if (t.ncities > TSP_DP_MAX)
+    {
+        error("Held-Karp only takes up to %d cities.\n", TSP_DP_MAX);
+        tsp_delrepr(t);
+        return 1;
+    }
+
+    double lowerbound = 0;
+    for (size_t i = 0; i < t.ncities; ++i)
+    {
+        lowerbound += t.short1[i] + t.short2[i];
+    }
+    lowerbound /= 2;
+    info("Lowerbound at root = %f\n", lowerbound);
+
+    exec_time = -omp_get_wtime();
+
+    tsp_result result = tsp_exe(t);
+
+    exec_time += omp_get_wtime();
+
+    fprintf(stderr, "%.1fs\n", exec_time);
+    if (lowerbound > limit)
+    {
+        info("Lowerbound %f is higher than the desired limit %f.\n", lowerbound, limit);
+        printf("NO SOLUTION\n");
+    }
+    else if (result.cost > limit)
+    {
+        info("Either the graph is not connected OR the lowerbound limit is too low!\n");
+        printf("NO SOLUTION\n");
+    }
+    else
+    {
+        // Print the tour
+        printf("%.1f\n", result.cost);
+        printf("%d", result.tour[0]);
+        for (size_t i = 1; i < t.ncities; ++i)
+        {
+            printf(" %d", result.tour[i]);
+        }
+        printf(" 0\n");
+    }
+
+    // Cleanup
+    free(result.tour);
+    tsp_delrepr(t);
+    return 0;
+}
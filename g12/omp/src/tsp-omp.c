@@ -1,523 +1,1230 @@
-#include <math.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-
-#include "debug.h"
-#include "matrix.h"
-
-#include "lib/nqueue/queue.h"
-
-typedef struct
-{
-    bool valid;
-    unsigned int ncities;
-    double *graph;
-    double *short1;
-    double *short2;
-} tsp_repr;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-    double bound;
-    unsigned int length;
-    unsigned int index;
-} tsp_node;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-} tsp_result;
-
-void tsp_delrepr(tsp_repr t)
-{
-    if (t.graph)
-    {
-        free(t.graph);
-    }
-    if (t.short1)
-    {
-        free(t.short1);
-    }
-    if (t.short2)
-    {
-        free(t.short2);
-    }
-}
-
-tsp_repr tsp_mkrepr(FILE *input)
-{
-    tsp_repr t;
-    t.graph = NULL;
-    t.short1 = NULL;
-    t.short2 = NULL;
-
-    int nroutes = -1;
-    int from = -1, to = -1;
-    double cost = -1;
-
-    if (fscanf(input, "%u %d", &(t.ncities), &nroutes) == 2)
-    {
-        t.graph = matrix_alloc(t.ncities);
-        t.short1 = array_alloc(t.ncities);
-        t.short2 = array_alloc(t.ncities);
-
-        if (!t.graph || !t.short1 || !t.short2)
-        {
-            error("Failed to allocate memory; aborting!\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    for (int i = 0; i < nroutes; i++)
-    {
-        if (fscanf(input, "%d %d %lf", &from, &to, &cost) == 3)
-        {
-            matrix_write(t.graph, t.ncities, from, to, cost);
-            matrix_write(t.graph, t.ncities, to, from, cost);
-
-            if (t.short1[from] > cost)
-            {
-                t.short2[from] = t.short1[from];
-                t.short1[from] = cost;
-            }
-            else if (t.short2[from] > cost)
-            {
-                t.short2[from] = cost;
-            }
-
-            if (t.short1[to] > cost)
-            {
-                t.short2[to] = t.short1[to];
-                t.short1[to] = cost;
-            }
-            else if (t.short2[to] > cost)
-            {
-                t.short2[to] = cost;
-            }
-        }
-        else
-        {
-            error("Error reading file.\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    fclose(input);
-
-    t.valid = true;
-    return t;
-}
-
-tsp_node *tsp_mknode(unsigned int length)
-{
-    tsp_node *node = malloc(sizeof(tsp_node));
-    node->tour = arrayi_alloc(length);
-    return node;
-}
-
-void tsp_delnode(tsp_node *node)
-{
-    if (node->tour)
-    {
-        free(node->tour);
-    }
-
-    free(node);
-}
-
-char tsp_queue_cmp(void *a, void *b)
-{
-    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
-    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
-    {
-        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
-    }
-
-    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
-}
-
-#define LOCK_QUEUE(i) omp_set_lock(locks + i)
-#define UNLOCK_QUEUE(i) omp_unset_lock(locks + i)
-
-tsp_result tsp_exe(tsp_repr rep, double lowerbound, double limit)
-{
-    double *graph = rep.graph;
-    double *short1 = rep.short1;
-    double *short2 = rep.short2;
-    unsigned int ncities = rep.ncities;
-    const unsigned int thread_num = omp_get_max_threads();
-    info("Running with numthreads = %d\n", thread_num);
-
-    unsigned int *btour = arrayi_alloc(ncities);
-    double btourcost = limit;
-    btour[0] = 0;
-    tsp_result result;
-
-    /**
-        Each thread will have it's own priority queue
-        To ensure orderly and relatively fine-grained load balancing, each queue will have it's own lock
-    */
-    priority_queue_t **queues = malloc(thread_num * sizeof(priority_queue_t *));
-    omp_lock_t *locks = malloc((thread_num) * sizeof(omp_lock_t));
-    bool *waiting = malloc(thread_num * sizeof(bool));
-
-    unsigned int finish = 0;
-    for (size_t k = 0; k < thread_num; k++)
-    {
-        queues[k] = queue_create(tsp_queue_cmp);
-        waiting[k] = false;
-        omp_init_lock(locks + k); // omp lock functions use pointers, hence why we're doing this
-    }
-
-    info("Starting parallel\n");
-#pragma omp parallel default(none) \
-    shared(stderr, queues, locks, btour, btourcost, graph, short1, short2, ncities, thread_num, waiting, finish, lowerbound)
-    {
-        int idx = omp_get_thread_num();
-        tsp_node *current = NULL, *new = NULL;
-        debug("Running preamble, %d\n", idx);
-        LOCK_QUEUE(idx);
-        double cost;
-        double update;
-        double newBound;
-
-#pragma omp for nowait
-        for (size_t i = 0; i < ncities; i++)
-        {
-            cost = matrix_read(graph, ncities, 0, i);
-            if (cost != INFINITY && 0 != i)
-            {
-                update = (cost >= short2[i] ? short2[i] : short1[i]) + (cost >= short2[0] ? short2[0] : short1[0]);
-                newBound = lowerbound + cost - (update / 2);
-                if (newBound > btourcost)
-                {
-                    continue;
-                }
-                new = tsp_mknode(2);
-                new->tour[0] = 0;
-                new->tour[1] = i;
-                new->cost = cost;
-                new->bound = newBound;
-                new->length = 2;
-                new->index = i;
-                debug("Pushing for thread = %d\n", idx);
-                queue_push(queues[idx], new);
-            }
-        }
-        UNLOCK_QUEUE(idx);
-
-        do
-        {
-            // Each thread pops the top element of the queue (if available)
-            if (queues[idx]->size > 0)
-            {
-                debug("Popping!\n");
-                LOCK_QUEUE(idx);
-                current = queue_pop(queues[idx]);
-                // There needs to be a counter that is reset every iteration, if all threads enter this if exiting needs to be activated
-                if (current->bound > btourcost)
-                {
-                    // If the best node doesn't work, then the others in the queue probably don't work either
-                    // Delete all the nodes because they are 100% garbage
-                    debug("Only low quality nodes at thread %d. Clearing the queue.\n", idx);
-                    while (queues[idx]->size > 0)
-                    {
-                        // NOTE: There's some optimization potential here because the bubbe-down step is unnecessary
-                        tsp_delnode(current);
-                        current = queue_pop(queues[idx]);
-                    }
-#pragma omp atomic write
-                    waiting[idx] = true;
-#pragma omp atomic update
-                    finish++;
-                    UNLOCK_QUEUE(idx);
-                }
-                else if (current->length == ncities)
-                {
-                    // This node represents a complete loop, so a tour cost can be computed
-                    // It becomes the new solution if it's better than the solution computed so far
-                    UNLOCK_QUEUE(idx);
-#pragma omp critical(update_btour)
-                    {
-                        double newcost = current->cost + matrix_read(graph, ncities, current->index, 0);
-                        if (newcost < btourcost)
-                        {
-                            for (size_t i = 1; i < ncities; i++)
-                            {
-                                btour[i] = current->tour[i];
-                            }
-
-                            btourcost = newcost;
-                        }
-                        else if (newcost == btourcost)
-                        {
-                            // If the cost is equal, prefer the one going through lower-numbered nodes first.
-                            bool check = true;
-                            for (size_t i = 1; i < ncities; i++)
-                            {
-                                if (check && btour[i] > current->tour[i])
-                                {
-                                    break;
-                                }
-                                else if (check && btour[i] < current->tour[i])
-                                {
-                                    check = false;
-                                }
-                                btour[i] = current->tour[i];
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    // Visit this node and generate all children nodes for it
-                    UNLOCK_QUEUE(idx);
-                    debug("Level: %u\n", current->length);
-                    debug("READ! %p: length %d tid %d\n", (void *)current->tour, current->length, idx);
-                    for (size_t c = 0; c < ncities; c++)
-                    {
-                        bool alreadyAdded = false;
-                        bool pushed = true;
-                        size_t here = current->index;
-                        double cost = matrix_read(graph, ncities, here, c);
-                        if (cost != INFINITY && c != here)
-                        {
-
-                            // The path to the city exists AND it's not to the same city we were already
-                            for (unsigned int j = 0; j < current->length; j++)
-                            {
-                                debug("Checking a given tour.\n");
-                                if (current->tour[j] == c)
-                                {
-                                    // We've already gone to this city, though
-                                    alreadyAdded = true;
-                                    break;
-                                }
-                            }
-                            if (alreadyAdded)
-                            {
-                                // We'd be visiting a node we've already visited, so ignore this node
-                                continue;
-                            }
-
-                            update = (cost >= short2[c] ? short2[c] : short1[c]) + (cost >= short2[here] ? short2[here] : short1[here]);
-                            newBound = current->bound + cost - (update / 2);
-
-                            // Make sure that this path is decent enough. Otherwise skip
-                            if (newBound > btourcost)
-                            {
-                                continue;
-                            }
-
-                            // This node is good!
-                            new = tsp_mknode(current->length + 1);
-                            for (unsigned int j = 0; j < current->length; j++)
-                            {
-                                new->tour[j] = current->tour[j];
-                            }
-                            new->tour[current->length] = c;
-                            new->cost = current->cost + cost;
-                            new->bound = newBound;
-                            new->length = current->length + 1;
-                            new->index = c;
-
-                            if (!pushed || finish == 0)
-                            {
-                                LOCK_QUEUE(idx);
-                                queue_push(queues[idx], new);
-                                UNLOCK_QUEUE(idx);
-                                pushed = true;
-                            }
-                            else
-                            {
-                                for (size_t ii = 0; ii < thread_num; ii++)
-                                {
-                                    if (waiting[ii]) // send work to waiting threads
-                                    {
-                                        LOCK_QUEUE(ii);
-                                        if (!waiting[ii]) // send work to waiting threads
-                                        {
-                                            UNLOCK_QUEUE(ii);
-                                            continue;
-                                        }
-                                        debug("ADD! %p: length %d tid %d\n", (void *)new->tour, new->length, idx);
-                                        queue_push(queues[ii], new);
-#pragma omp atomic update
-                                        finish--;
-                                        waiting[ii] = false;
-
-                                        UNLOCK_QUEUE(ii);
-                                        pushed = false;
-                                        break;
-                                    }
-                                    else if (finish == 0)
-                                    {
-                                        break;
-                                    }
-                                }
-
-                                if (pushed)
-                                {
-                                    LOCK_QUEUE(idx);
-                                    queue_push(queues[idx], new);
-                                    UNLOCK_QUEUE(idx);
-                                    pushed = false;
-                                }
-                            }
-                            debug("Done pushing!\n");
-                        }
-                    }
-                }
-                if (current != NULL)
-                {
-                    tsp_delnode(current);
-                }
-                debug("Queue size: %lu\n", queues[idx]->size);
-            }
-            else
-            {
-                waiting[idx] = true;
-#pragma omp atomic update
-                finish++;
-                debug("Queue is empty\n");
-            }
-
-            if (finish == thread_num)
-            {
-                debug("%u %u\n", finish, thread_num);
-                for (size_t k = 0; k < thread_num; k++)
-                {
-                    waiting[k] = false;
-                    debug("%u\n", k);
-                }
-            }
-
-            int i;
-            while (waiting[idx])
-            {
-#pragma omp atomic update
-                i++;
-            }
-        } while (finish != thread_num);
-    }
-
-    result.tour = btour;
-    result.cost = btourcost;
-
-    for (size_t k = 0; k < thread_num; k++)
-    {
-        while (queues[k]->size > 0)
-        {
-            tsp_delnode(queue_pop(queues[k]));
-        }
-        queue_delete(queues[k]);
-        free(queues[k]);
-        omp_destroy_lock(locks + k);
-    }
-    free(queues);
-    free(waiting);
-
-    return result;
-}
-
-void help(char *me)
-{
-    printf("USAGE: %s inputfile lowerbound\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
-}
-
-int main(int argc, char *argv[])
-{
-    double limit = INFINITY;
-    double exec_time;
-
-    // Argument validation
-    if (argc <= 2)
-    {
-        error("No arguments provided.\n");
-        help(argv[0]);
-        return 1;
-    }
-    else if (argc > 3)
-    {
-        error("Too many arguments.\n");
-        help(argv[0]);
-        return 1;
-    }
-
-    // Make sure that the lowerbound arg is a number
-    if (argc != 3 || atof(argv[2]) <= 0)
-    {
-        // Either the value is 0 (not allowed) or it is not a number.
-        // If that's the case ignore this.
-        warn("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
-    }
-    else
-    {
-        limit = (double)atof(argv[2]);
-    }
-    info("Cost must be <= %f\n", limit);
-    info("File target: %s\n", argv[1]);
-    FILE *input = fopen(argv[1], "r");
-    if (!input)
-    {
-        syserr("Could not open the input file");
-        return 1;
-    }
-
-    tsp_repr t = tsp_mkrepr(input);
-    if (!t.valid)
-    {
-        // An earlier error happened preventing us from carrying on
-        tsp_delrepr(t);
-        return 1;
-    }
-
-    double lowerbound = 0;
-    for (size_t i = 0; i < t.ncities; ++i)
-    {
-        lowerbound += t.short1[i] + t.short2[i];
-    }
-    lowerbound /= 2;
-    info("Lowerbound at root = %f\n", lowerbound);
-
-    exec_time = -omp_get_wtime();
-
-    tsp_result result = tsp_exe(t, lowerbound, limit);
-
-    exec_time += omp_get_wtime();
-
-    fprintf(stderr, "%.1fs\n", exec_time);
-    if (lowerbound > limit)
-    {
-        info("Lowerbound %f is higher than the desired limit %f.\n", lowerbound, limit);
-        printf("NO SOLUTION\n");
-    }
-    else if (result.cost > limit)
-    {
-        info("Either the graph is not connected OR the lowerbound limit is too low!\n");
-        printf("NO SOLUTION\n");
-    }
-    else
-    {
-        // Print the tour
-        printf("%.1f\n", result.cost);
-        printf("%d", result.tour[0]);
-        for (size_t i = 1; i < t.ncities; ++i)
-        {
-            printf(" %d", result.tour[i]);
-        }
-        printf(" 0\n");
-    }
-
-    // Cleanup
-    free(result.tour);
-    tsp_delrepr(t);
-    return 0;
-}
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <omp.h>
+
+#include "bound.h"
+#include "debug.h"
+#include "deque.h"
+#include "dominance.h"
+#include "endgame.h"
+#include "feasible.h"
+#include "expand.h"
+#include "heuristic.h"
+#include "mirror.h"
+#include "options.h"
+#include "reduce.h"
+#include "relabel.h"
+#include "matrix.h"
+#include "node.h"
+#include "repr.h"
+
+#include "lib/nqueue/queue.h"
+
+#ifndef TSP_BUCKETS
+#define TSP_BUCKETS 0
+#endif
+
+typedef struct
+{
+    unsigned int *tour;
+    double cost;
+} tsp_result;
+
+void tsp_queue_delnode(void *node)
+{
+    tsp_delnode(node);
+}
+
+// Delete every queued node whose bound is above cost
+void tsp_queue_prune(priority_queue_t *queue, double cost)
+{
+    // With the largest possible index, nodes that tie with cost still sort before the threshold
+    tsp_node threshold = {.bound = cost, .index = UINT_MAX};
+    queue_prune(queue, &threshold, tsp_queue_delnode);
+}
+
+char tsp_queue_cmp(void *a, void *b)
+{
+    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
+    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
+    {
+        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
+    }
+
+    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
+}
+
+#if TSP_BUCKETS
+// Bounds are multiples of 0.05 (costs have one decimal), so twenty keys per unit of cost
+long tsp_queue_key(void *a)
+{
+    double key = ((tsp_node *)a)->bound * 20;
+    return key < LONG_MAX / 2 ? (long)(key + 0.5) : LONG_MAX / 2;
+}
+#endif
+
+// Nodes a thread stages on its deque at a time, while another thread is out of work
+#define STEAL_BATCH 8
+// Heaps per thread with --scheduler=multiqueue
+#define MQ_FACTOR 2
+// Rounds of looking for work an idle thread goes through before it goes to sleep
+#define IDLE_ROUNDS 64
+// With --scheduler=tasks, a node whose bound is within this fraction of the incumbent has little
+// left under it, so it goes to a task whatever its depth
+#define TASK_CLOSE 0.02
+
+// One of the heaps of --scheduler=multiqueue
+typedef struct
+{
+    omp_lock_t lock;
+    priority_queue_t *queue;
+    // The bound of the best node in queue and how many there are, kept up to date under the lock
+    // but read without it to pick a heap
+    double top;
+    size_t size;
+    // Keep heaps that different threads lock apart
+    char pad[64];
+} tsp_heap;
+
+// The nodes of one task of --scheduler=tasks, newest on top
+typedef struct
+{
+    tsp_node **nodes;
+    size_t size;
+    size_t max_size;
+} tsp_stack;
+
+typedef struct tsp_worker tsp_worker;
+
+// What the threads share
+typedef struct
+{
+    tsp_repr rep;
+    double lowerbound;
+    tsp_options options;
+    unsigned int thread_num;
+    // The cost to beat: every thread lowers it with a compare-and-swap as soon as it finds a cheaper
+    // tour, and reads it (relaxed) to prune. The tours themselves stay with the threads until the end.
+    _Atomic double btourcost;
+    // The heuristic tour, until a thread that found one as cheap as the incumbent (found) puts its own
+    unsigned int *btour;
+    bool found;
+    // Only set with --dominance; one table for every thread
+    tsp_dominance *dominance;
+    // Only set with --feasibility=check; it is only ever read, so one serves every thread
+    tsp_feasible *feasible;
+
+    // --scheduler=steal: a queue and a deque per thread, and how many threads hold any node
+    priority_queue_t **queues;
+    tsp_deque **deques;
+    unsigned int busy;
+
+    // --scheduler=multiqueue: the heaps, and how many nodes are queued or being visited
+    tsp_heap *heaps;
+    unsigned int nheaps;
+    unsigned long pending;
+
+    // --scheduler=tasks: every thread's own state, for the tasks it happens to run
+    tsp_worker **workers;
+
+    // Idle threads that found nothing for a while sleep on park until nodes turn up or the search is over
+    pthread_mutex_t park_lock;
+    pthread_cond_t park;
+    unsigned int parked;
+
+    // --numa=places: a copy of the instance per OpenMP place, made by the first thread to get there,
+    // and the place of every thread (-1 until it is known)
+    tsp_repr *replicas;
+    int nplaces;
+    int *places;
+
+    unsigned long expanded;
+    unsigned long infeasible;
+    tsp_endgame_stats endgame;
+} tsp_search;
+
+// What each thread keeps to itself
+struct tsp_worker
+{
+    int idx;
+    // The instance, as copied to this thread's place with --numa=places
+    tsp_repr rep;
+    int place;
+    unsigned int *tour;
+    unsigned int *cities;
+    double *bounds;
+    // Only set with --bound=1tree; every thread works out the same root penalties on its own
+    tsp_bound *onetree;
+    // Only set with --endgame; each thread remembers its own completions
+    tsp_endgame *endgame;
+    unsigned long expanded;
+    unsigned long dropped;
+    // The best tour this thread found, if found is set
+    unsigned int *btour;
+    double btourcost;
+    bool found;
+    // xorshift, for picking other threads' deques or heaps at random
+    unsigned int state;
+    // --scheduler=tasks: where the children of the node being visited go
+    tsp_stack *stack;
+};
+
+unsigned int tsp_random(tsp_worker *worker)
+{
+    unsigned int x = worker->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->state = x;
+    return x;
+}
+
+// The cost to beat, as far as this thread can tell
+double tsp_incumbent(tsp_search *search)
+{
+    return atomic_load_explicit(&search->btourcost, memory_order_relaxed);
+}
+
+// Whether tour a wins over tour b of the same cost. As with the mirror images of a tour, that is the
+// one going through higher-numbered cities first (in the input's numbers, should the cities have
+// been renumbered).
+bool tsp_tour_before(tsp_repr rep, const unsigned int *a, const unsigned int *b)
+{
+    for (size_t i = 1; i < rep.ncities; i++)
+    {
+        if (a[i] != b[i])
+        {
+            return tsp_repr_label(rep, a[i]) > tsp_repr_label(rep, b[i]);
+        }
+    }
+    return false;
+}
+
+// Whether a sleeping thread would have anything to do: nodes it could take, or leave
+bool tsp_awake(tsp_search *search)
+{
+    if (search->options.scheduler == TSP_SCHEDULER_MULTIQUEUE)
+    {
+        unsigned long pending;
+#pragma omp atomic read seq_cst
+        pending = search->pending;
+        for (unsigned int k = 0; pending > 0 && k < search->nheaps; k++)
+        {
+            size_t size;
+#pragma omp atomic read
+            size = search->heaps[k].size;
+            if (size > 0)
+            {
+                return true;
+            }
+        }
+        return pending == 0;
+    }
+
+    unsigned int busy;
+#pragma omp atomic read seq_cst
+    busy = search->busy;
+    for (unsigned int k = 0; busy > 0 && k < search->thread_num; k++)
+    {
+        if (tsp_deque_size(search->deques[k]) > 0)
+        {
+            return true;
+        }
+    }
+    return busy == 0;
+}
+
+// Sleep until woken, unless there is something to do already
+void tsp_park(tsp_search *search)
+{
+    pthread_mutex_lock(&search->park_lock);
+#pragma omp atomic update seq_cst
+    search->parked++;
+    // Whoever hands out nodes looks for sleepers after doing so, and this thread looks for nodes
+    // after counting itself in, so at least one of the two sees the other
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!tsp_awake(search))
+    {
+        pthread_cond_wait(&search->park, &search->park_lock);
+    }
+#pragma omp atomic update seq_cst
+    search->parked--;
+    pthread_mutex_unlock(&search->park_lock);
+}
+
+// Wake a sleeping thread to take nodes just handed out, or every one of them once the search is over
+void tsp_wake(tsp_search *search, bool all)
+{
+    unsigned int parked;
+    atomic_thread_fence(memory_order_seq_cst);
+#pragma omp atomic read seq_cst
+    parked = search->parked;
+    if (parked > 0)
+    {
+        pthread_mutex_lock(&search->park_lock);
+        if (all)
+        {
+            pthread_cond_broadcast(&search->park);
+        }
+        else
+        {
+            pthread_cond_signal(&search->park);
+        }
+        pthread_mutex_unlock(&search->park_lock);
+    }
+}
+
+// One thread fewer holds any node (--scheduler=steal)
+void tsp_idle(tsp_search *search)
+{
+    unsigned int left;
+#pragma omp atomic capture seq_cst
+    left = --search->busy;
+    if (left == 0)
+    {
+        tsp_wake(search, true);
+    }
+}
+
+// One node fewer is queued or being visited (--scheduler=multiqueue)
+void tsp_settle(tsp_search *search)
+{
+    unsigned long left;
+#pragma omp atomic capture seq_cst
+    left = --search->pending;
+    if (left == 0)
+    {
+        tsp_wake(search, true);
+    }
+}
+
+// Move the best nodes of queue to deque. The very best goes last, so that the owner pops it first
+// and thieves take the worst of the batch.
+void tsp_stage(priority_queue_t *queue, tsp_deque *deque)
+{
+    tsp_node *batch[STEAL_BATCH];
+    unsigned int n = 0;
+    while (n < STEAL_BATCH && queue->size > 1)
+    {
+        batch[n++] = queue_pop(queue);
+    }
+    while (n > 0)
+    {
+        // Only ever staged on an empty deque, which has room for a batch
+        tsp_deque_push(deque, batch[--n]);
+    }
+}
+
+// Take up to half of what victim has staged into queue. Returns how many nodes came over.
+unsigned int tsp_steal(tsp_deque *victim, priority_queue_t *queue)
+{
+    size_t want = (tsp_deque_size(victim) + 1) / 2;
+    unsigned int got = 0;
+    tsp_node *node;
+    while (got < want && (node = tsp_deque_steal(victim)))
+    {
+        queue_push(queue, node);
+        got++;
+    }
+    return got;
+}
+
+// Refresh what is known of heap from outside; its lock must be held
+void tsp_heap_update(tsp_heap *heap)
+{
+    tsp_node *best = queue_top(heap->queue);
+#pragma omp atomic write
+    heap->top = best ? best->bound : INFINITY;
+#pragma omp atomic write
+    heap->size = heap->queue->size;
+}
+
+// Queue node on whichever random heap is not locked
+void tsp_mq_push(tsp_search *search, tsp_worker *worker, tsp_node *node)
+{
+#pragma omp atomic update seq_cst
+    search->pending++;
+    while (true)
+    {
+        tsp_heap *heap = search->heaps + tsp_random(worker) % search->nheaps;
+        if (omp_test_lock(&heap->lock))
+        {
+            queue_push(heap->queue, node);
+            tsp_heap_update(heap);
+            omp_unset_lock(&heap->lock);
+            tsp_wake(search, false);
+            return;
+        }
+    }
+}
+
+// The best of the tops of two random heaps, or NULL if a few tries came up with nothing
+tsp_node *tsp_mq_pop(tsp_search *search, tsp_worker *worker)
+{
+    for (unsigned int tries = 0; tries < search->nheaps; tries++)
+    {
+        tsp_heap *a = search->heaps + tsp_random(worker) % search->nheaps;
+        tsp_heap *b = search->heaps + tsp_random(worker) % search->nheaps;
+        double atop, btop;
+        size_t asize, bsize;
+#pragma omp atomic read
+        atop = a->top;
+#pragma omp atomic read
+        btop = b->top;
+#pragma omp atomic read
+        asize = a->size;
+#pragma omp atomic read
+        bsize = b->size;
+        tsp_heap *heap = bsize > 0 && (asize == 0 || btop < atop) ? b : a;
+        if ((heap == a ? asize : bsize) == 0 || !omp_test_lock(&heap->lock))
+        {
+            continue;
+        }
+
+        tsp_node *node = queue_pop(heap->queue);
+        if (node && node->bound > tsp_incumbent(search))
+        {
+            // Nothing else in this heap is any good either
+            size_t before = heap->queue->size;
+            queue_prune(heap->queue, node, tsp_queue_delnode);
+#pragma omp atomic update seq_cst
+            search->pending -= before - heap->queue->size;
+        }
+        tsp_heap_update(heap);
+        omp_unset_lock(&heap->lock);
+        if (node)
+        {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+void tsp_stack_push(tsp_stack *stack, tsp_node *node)
+{
+    if (stack->size == stack->max_size)
+    {
+        stack->max_size = stack->max_size ? 2 * stack->max_size : 64;
+        stack->nodes = realloc(stack->nodes, stack->max_size * sizeof(tsp_node *));
+        if (!stack->nodes)
+        {
+            error("Failed to allocate memory; aborting!\n");
+            exit(1);
+        }
+    }
+    stack->nodes[stack->size++] = node;
+}
+
+// Hand node over to the scheduler
+void tsp_push(tsp_search *search, tsp_worker *worker, tsp_node *node)
+{
+    if (search->options.scheduler == TSP_SCHEDULER_MULTIQUEUE)
+    {
+        tsp_mq_push(search, worker, node);
+    }
+    else if (search->options.scheduler == TSP_SCHEDULER_TASKS)
+    {
+        tsp_stack_push(worker->stack, node);
+    }
+    else
+    {
+        queue_push(search->queues[worker->idx], node);
+    }
+}
+
+// Record the complete tour of current if it beats the best one this thread has, and have every
+// thread prune with its cost if it beats theirs
+void tsp_complete(tsp_search *search, tsp_worker *worker, tsp_node *current)
+{
+    tsp_repr rep = worker->rep;
+    unsigned int ncities = rep.ncities;
+    unsigned int *tour = worker->tour;
+
+    tsp_node_tour(current, tour);
+    double newcost = current->cost + matrix_read(rep.graph, ncities, current->index, 0);
+    if (search->options.symmetry || worker->onetree)
+    {
+        // Only one direction of the tour was searched (or, with the 1-tree bound, may have made it
+        // through); weigh the other one as if it had been too
+        double back = tsp_mirror_key_of(rep, search->lowerbound, tour, true).cost;
+        size_t i = 1;
+        while (i < ncities && tour[ncities - i] == tour[i])
+        {
+            i++;
+        }
+        if (back < newcost || (back == newcost && i < ncities && tsp_repr_label(rep, tour[ncities - i]) > tsp_repr_label(rep, tour[i])))
+        {
+            tsp_mirror_reverse(tour, ncities);
+            newcost = back;
+        }
+    }
+
+    // Among tours of the same cost, which one wins must not depend on which thread found which
+    if (newcost > worker->btourcost || newcost > tsp_incumbent(search) ||
+        (newcost == worker->btourcost && worker->found && !tsp_tour_before(rep, tour, worker->btour)))
+    {
+        return;
+    }
+    for (size_t i = 1; i < ncities; i++)
+    {
+        worker->btour[i] = tour[i];
+    }
+    worker->btourcost = newcost;
+    worker->found = true;
+
+    double seen = tsp_incumbent(search);
+    while (newcost < seen &&
+           !atomic_compare_exchange_weak_explicit(&search->btourcost, &seen, newcost, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+// Deal with a node that was just taken off the frontier (and that its bound does not rule out),
+// pushing whatever comes of it
+void tsp_visit(tsp_search *search, tsp_worker *worker, tsp_node *current)
+{
+    tsp_repr rep = worker->rep;
+    unsigned int ncities = rep.ncities;
+
+    if (current->length == ncities)
+    {
+        // This node represents a complete loop, so a tour cost can be computed
+        // It becomes the new solution if it's better than the solution computed so far
+        tsp_complete(search, worker, current);
+    }
+    else if (search->dominance && tsp_dominance_stale(search->dominance, current))
+    {
+        // A cheaper way to the same cities turned up while this node was queued
+    }
+    else if (worker->endgame && tsp_endgame_covers(worker->endgame, current))
+    {
+        // The rest of the tour comes back as complete nodes, which take their turn in the queue like any other
+        tsp_endgame_solve(worker->endgame, current, worker->onetree ? tsp_bound_halfsum(current) : current->bound,
+                          tsp_incumbent(search));
+        for (tsp_node *complete; (complete = tsp_endgame_next(worker->endgame));)
+        {
+            tsp_push(search, worker, complete);
+        }
+    }
+    else
+    {
+        // Visit this node and generate all children nodes for it
+        debug("Level: %u\n", current->length);
+        debug("READ! %p: length %d tid %d\n", (void *)current, current->length, worker->idx);
+        size_t here = current->index;
+        worker->expanded++;
+        // Only the children that are decent enough come back
+        double base = worker->onetree ? tsp_bound_halfsum(current) : current->bound;
+        double threshold = tsp_incumbent(search);
+        unsigned int found = tsp_expand_city(&rep, here, tsp_node_visited(current), base, threshold, worker->cities, worker->bounds);
+        if (search->options.symmetry)
+        {
+            found = tsp_mirror_filter(current, ncities, worker->cities, worker->bounds, found);
+        }
+        for (unsigned int k = 0; k < found; k++)
+        {
+            // This node is good!
+            tsp_node *new = tsp_node_child(current, worker->cities[k]);
+            new->cost = current->cost + matrix_read(rep.graph, ncities, here, worker->cities[k]);
+            new->bound = worker->bounds[k];
+            if (search->feasible && !tsp_feasible_child(search->feasible, here, new))
+            {
+                worker->dropped++;
+                tsp_delnode(new);
+                continue;
+            }
+            if (worker->onetree && (new->bound = tsp_bound_child(worker->onetree, current, new, threshold)) > threshold)
+            {
+                tsp_delnode(new);
+                continue;
+            }
+            if (search->dominance && tsp_dominance_insert(search->dominance, new))
+            {
+                tsp_delnode(new);
+                continue;
+            }
+            tsp_push(search, worker, new);
+        }
+    }
+}
+
+/**
+    --scheduler=steal
+    Each thread searches from its own priority queue, which no other thread touches.
+    While some thread is out of work, the others stage their best few nodes on a deque (see deque.h)
+    for it to steal from, working through them themselves until it does.
+    A thread counts as busy while it holds any node, and so does a thief while it steals. Once no
+    thread is busy, no node is left anywhere and none can turn up again, so the search is over.
+    A thread that keeps finding nothing to steal sleeps until a batch is staged or the search ends.
+*/
+void tsp_run_steal(tsp_search *search, tsp_worker *worker)
+{
+    const unsigned int thread_num = search->thread_num;
+    priority_queue_t *queue = search->queues[worker->idx];
+    tsp_deque *deque = search->deques[worker->idx];
+    bool holding = true;
+    unsigned int rounds = 0;
+    double pruned = tsp_incumbent(search);
+    while (true)
+    {
+        // Drop whatever a newer incumbent (found by any thread) has made useless
+        double incumbent = tsp_incumbent(search);
+        if (incumbent < pruned)
+        {
+            pruned = incumbent;
+            tsp_queue_prune(queue, pruned);
+        }
+
+        // Staged nodes are the best this thread had, so they go first
+        tsp_node *current = tsp_deque_pop(deque);
+        if (!current && queue->size > 0)
+        {
+            current = queue_pop(queue);
+        }
+        if (!current)
+        {
+            if (holding)
+            {
+                holding = false;
+                tsp_idle(search);
+                debug("Queue is empty at thread %d\n", worker->idx);
+            }
+
+            unsigned int victim = thread_num > 1 ? tsp_random(worker) % (thread_num - 1) : 0;
+            victim += victim >= (unsigned int)worker->idx;
+            // With --numa=places, nodes on another place are only worth going for after a while
+            bool near = true;
+            if (search->places && rounds < IDLE_ROUNDS / 2)
+            {
+                int place;
+#pragma omp atomic read
+                place = search->places[victim];
+                near = place == worker->place;
+            }
+            if (thread_num > 1 && near && tsp_deque_size(search->deques[victim]) > 0)
+            {
+                // Busy before the first node comes over, so that no one takes the search for over meanwhile
+#pragma omp atomic update seq_cst
+                search->busy++;
+                if (tsp_steal(search->deques[victim], queue) > 0)
+                {
+                    debug("Thread %d stole from %u\n", worker->idx, victim);
+                    holding = true;
+                    rounds = 0;
+                    continue;
+                }
+                tsp_idle(search);
+            }
+
+            unsigned int left;
+#pragma omp atomic read seq_cst
+            left = search->busy;
+            if (left == 0)
+            {
+                break;
+            }
+            if (++rounds == IDLE_ROUNDS)
+            {
+                tsp_park(search);
+                rounds = 0;
+            }
+            continue;
+        }
+
+        if (current->bound > tsp_incumbent(search))
+        {
+            // Nothing in the queue that does not come before current is any good either
+            debug("Only low quality nodes at thread %d. Clearing the queue.\n", worker->idx);
+            queue_prune(queue, current, tsp_queue_delnode);
+        }
+        else
+        {
+            tsp_visit(search, worker, current);
+        }
+        tsp_delnode(current);
+        debug("Queue size: %lu\n", queue->size);
+
+        // Someone is out of work: put a batch where they can get at it
+        if (thread_num > 1 && queue->size > 1 && tsp_deque_size(deque) == 0)
+        {
+            unsigned int working;
+#pragma omp atomic read seq_cst
+            working = search->busy;
+            if (working < thread_num)
+            {
+                tsp_stage(queue, deque);
+                tsp_wake(search, false);
+            }
+        }
+    }
+}
+
+/**
+    --scheduler=multiqueue
+    A relaxed best-first frontier: MQ_FACTOR heaps per thread, each behind its own lock, that any
+    thread pushes to at random and pops from by taking the better top of two random heaps, going on
+    to others whenever a lock is taken. The nodes popped are close to the best ones anywhere, with
+    next to no contention.
+    Every node is pending from the moment it is pushed until its visit is over (by which time its
+    children are pending themselves), so once nothing is pending the search is over.
+    A thread that keeps finding every heap it tries empty sleeps until a node is pushed or the search ends.
+*/
+void tsp_run_multiqueue(tsp_search *search, tsp_worker *worker)
+{
+    unsigned int rounds = 0;
+    while (true)
+    {
+        tsp_node *current = tsp_mq_pop(search, worker);
+        if (!current)
+        {
+            unsigned long left;
+#pragma omp atomic read seq_cst
+            left = search->pending;
+            if (left == 0)
+            {
+                break;
+            }
+            if (++rounds == IDLE_ROUNDS)
+            {
+                tsp_park(search);
+                rounds = 0;
+            }
+            continue;
+        }
+        rounds = 0;
+
+        if (current->bound <= tsp_incumbent(search))
+        {
+            tsp_visit(search, worker, current);
+        }
+        tsp_delnode(current);
+        tsp_settle(search);
+    }
+}
+
+void tsp_task(tsp_search *search, tsp_node *node);
+
+// Hand the subtree under node to whichever thread the OpenMP runtime picks
+void tsp_spawn(tsp_search *search, tsp_node *node)
+{
+#pragma omp task default(none) firstprivate(search, node)
+    tsp_task(search, node);
+}
+
+// Search the subtree under node depth-first, best child first, on a stack no other task sees. Every task_grain nodes, all but the newest node left go to tasks of their own: those
+// are the shallowest, so idle threads get the biggest pieces.
+void tsp_task(tsp_search *search, tsp_node *node)
+{
+    // Tasks are tied, so this stays the thread running the task even across the spawns below
+    tsp_worker *worker = search->workers[omp_get_thread_num()];
+    tsp_stack stack = {0};
+    unsigned long visited = 0;
+    tsp_stack_push(&stack, node);
+    while (stack.size > 0)
+    {
+        tsp_node *current = stack.nodes[--stack.size];
+        if (current->bound <= tsp_incumbent(search))
+        {
+            // Another task may have run on this thread since the last visit, at a spawn
+            worker->stack = &stack;
+            size_t first = stack.size;
+            tsp_visit(search, worker, current);
+            // The children come in city order; put the lowest bound on top
+            for (size_t k = first + 1; k < stack.size; k++)
+            {
+                tsp_node *child = stack.nodes[k];
+                size_t j = k;
+                while (j > first && stack.nodes[j - 1]->bound < child->bound)
+                {
+                    stack.nodes[j] = stack.nodes[j - 1];
+                    j--;
+                }
+                stack.nodes[j] = child;
+            }
+            visited++;
+        }
+        tsp_delnode(current);
+
+        if (search->options.task_grain && visited >= search->options.task_grain && stack.size > 1)
+        {
+            for (size_t k = 0; k + 1 < stack.size; k++)
+            {
+                tsp_spawn(search, stack.nodes[k]);
+            }
+            stack.nodes[0] = stack.nodes[stack.size - 1];
+            stack.size = 1;
+            visited = 0;
+        }
+    }
+    free(stack.nodes);
+}
+
+/**
+    --scheduler=tasks
+    One thread expands the top of the tree best-first from a queue of its own. Nodes with task_depth
+    cities on their tour, or with a bound close to the incumbent, are not expanded there but become
+    OpenMP tasks, each searching its subtree depth-first on a stack of its own (see tsp_task). The
+    other threads run tasks as they come, and the OpenMP runtime balances them by stealing tasks
+    between threads. The search is over once the queue is empty and every task has finished, which
+    the barrier closing the single construct that runs this waits for.
+*/
+void tsp_run_tasks(tsp_search *search, tsp_worker *worker, tsp_node *root)
+{
+#if TSP_BUCKETS
+    priority_queue_t *frontier = queue_create_buckets(tsp_queue_cmp, tsp_queue_key);
+#else
+    priority_queue_t *frontier = queue_create(tsp_queue_cmp);
+#endif
+    tsp_stack children = {0};
+    queue_push(frontier, root);
+    while (frontier->size > 0)
+    {
+        tsp_node *current = queue_pop(frontier);
+        double incumbent = tsp_incumbent(search);
+        if (current->bound > incumbent)
+        {
+            // Nothing in the queue that does not come before current is any good either
+            queue_prune(frontier, current, tsp_queue_delnode);
+            tsp_delnode(current);
+            continue;
+        }
+        if (current->length >= search->options.task_depth ||
+            (incumbent != INFINITY && incumbent - current->bound <= TASK_CLOSE * incumbent))
+        {
+            tsp_spawn(search, current);
+            continue;
+        }
+
+        worker->stack = &children;
+        tsp_visit(search, worker, current);
+        tsp_delnode(current);
+        while (children.size > 0)
+        {
+            queue_push(frontier, children.nodes[--children.size]);
+        }
+    }
+    free(children.nodes);
+    queue_delete(frontier);
+    free(frontier);
+}
+
+// Search from the heuristic tour btour, of cost seed, which becomes the result's tour
+tsp_result tsp_exe(tsp_repr rep, double lowerbound, double limit, double seed, unsigned int *btour, tsp_options options)
+{
+    unsigned int ncities = rep.ncities;
+    const unsigned int thread_num = omp_get_max_threads();
+    info("Running with numthreads = %d\n", thread_num);
+
+    tsp_search search = {.rep = rep, .lowerbound = lowerbound, .options = options, .thread_num = thread_num};
+    search.btour = btour;
+    // Start from the heuristic tour. Half a cost step above it prunes nearly as hard as the tour itself
+    // would, and still leaves room for the search to find (and report) its own optimal tour.
+    const double upper = seed + TSP_COST_STEP / 2;
+    // Without some of its edges the graph's bounds get as tight as the tours left, and can come out a
+    // rounding error over one right on the limit
+    const double reach = options.reduce ? limit + TSP_COST_SLACK(limit) : limit;
+    atomic_init(&search.btourcost, upper < reach ? upper : reach);
+    search.btour[0] = 0;
+    tsp_result result;
+
+    search.dominance = options.dominance ? tsp_dominance_create(ncities, options.dominance, options.symmetry) : NULL;
+    search.feasible = options.feasibility ? tsp_feasible_create(rep) : NULL;
+    if (options.scheduler == TSP_SCHEDULER_MULTIQUEUE)
+    {
+        search.nheaps = MQ_FACTOR * thread_num;
+        search.heaps = calloc(search.nheaps, sizeof(tsp_heap));
+        for (size_t k = 0; k < search.nheaps; k++)
+        {
+#if TSP_BUCKETS
+            search.heaps[k].queue = queue_create_buckets(tsp_queue_cmp, tsp_queue_key);
+#else
+            search.heaps[k].queue = queue_create(tsp_queue_cmp);
+#endif
+            search.heaps[k].top = INFINITY;
+            omp_init_lock(&search.heaps[k].lock);
+        }
+        // Every thread has the root children it pushes pending until it is done with them
+        search.pending = thread_num;
+    }
+    else if (options.scheduler == TSP_SCHEDULER_TASKS)
+    {
+        search.workers = calloc(thread_num, sizeof(tsp_worker *));
+    }
+    else
+    {
+        search.queues = malloc(thread_num * sizeof(priority_queue_t *));
+        search.deques = malloc(thread_num * sizeof(tsp_deque *));
+        for (size_t k = 0; k < thread_num; k++)
+        {
+#if TSP_BUCKETS
+            search.queues[k] = queue_create_buckets(tsp_queue_cmp, tsp_queue_key);
+#else
+            search.queues[k] = queue_create(tsp_queue_cmp);
+#endif
+            search.deques[k] = tsp_deque_create();
+        }
+        search.busy = thread_num;
+    }
+    pthread_mutex_init(&search.park_lock, NULL);
+    pthread_cond_init(&search.park, NULL);
+    if (options.numa)
+    {
+        search.nplaces = omp_get_num_places();
+        if (search.nplaces == 0 || omp_get_proc_bind() == omp_proc_bind_false)
+        {
+            warn("--numa=places needs threads bound to places (say OMP_PLACES=sockets OMP_PROC_BIND=spread); going without.\n");
+        }
+        else
+        {
+            info("Copying the instance to %d places\n", search.nplaces);
+            search.replicas = calloc(search.nplaces, sizeof(tsp_repr));
+            search.places = malloc(thread_num * sizeof(int));
+            for (size_t k = 0; k < thread_num; k++)
+            {
+                search.places[k] = -1;
+            }
+        }
+    }
+
+    info("Starting parallel\n");
+#pragma omp parallel default(none) shared(stderr, search, ncities, lowerbound, rep, options)
+    {
+        tsp_worker worker = {.idx = omp_get_thread_num(), .rep = rep, .place = -1};
+        if (search.replicas && omp_get_place_num() >= 0)
+        {
+            worker.place = omp_get_place_num();
+#pragma omp atomic write
+            search.places[worker.idx] = worker.place;
+            // The first thread on a place makes its copy, so that every page of it is local to that place
+#pragma omp critical(replicas)
+            {
+                if (!search.replicas[worker.place].graph)
+                {
+                    search.replicas[worker.place] = tsp_repr_copy(rep);
+                }
+                worker.rep = search.replicas[worker.place];
+            }
+            if (!worker.rep.valid)
+            {
+                exit(1);
+            }
+        }
+        worker.tour = arrayi_alloc(ncities);
+        worker.cities = arrayi_alloc(ncities);
+        worker.bounds = array_alloc(ncities);
+        worker.btour = arrayi_alloc(ncities);
+        worker.btour[0] = 0;
+        worker.btourcost = tsp_incumbent(&search);
+        worker.state = 2654435761u * (worker.idx + 1);
+        debug("Running preamble, %d\n", worker.idx);
+        worker.onetree = options.bound == TSP_BOUND_ONETREE ? tsp_bound_create(worker.rep) : NULL;
+        worker.endgame = options.endgame ? tsp_endgame_create(worker.rep, options.endgame) : NULL;
+        tsp_pool_init(ncities, worker.onetree ? tsp_bound_extra(ncities) : 0);
+        tsp_node *root = tsp_node_root(lowerbound);
+        if (worker.onetree)
+        {
+            root->bound = tsp_bound_root(worker.onetree, root, tsp_incumbent(&search));
+        }
+
+        if (options.scheduler == TSP_SCHEDULER_TASKS)
+        {
+            // A thread only runs tasks once it reaches the barrier of the single construct, by which
+            // time its own state is there
+            search.workers[worker.idx] = &worker;
+#pragma omp single
+            {
+                tsp_run_tasks(&search, &worker, root);
+                root = NULL;
+            }
+            // The other threads' roots were only there for the 1-tree penalties
+            if (root)
+            {
+                tsp_delnode(root);
+            }
+        }
+        else
+        {
+#pragma omp for nowait
+            for (size_t i = 0; i < ncities; i++)
+            {
+                double cost = matrix_read(worker.rep.graph, ncities, 0, i);
+                if (cost != INFINITY && 0 != i)
+                {
+                    double newBound = lowerbound + matrix_read(worker.rep.delta, ncities, 0, i);
+                    // Breaking symmetry, a tour starting 0 -> ncities-1 could only come back through a lower city
+                    double threshold = tsp_incumbent(&search);
+                    if (newBound > threshold || (options.symmetry && ncities > 2 && i == ncities - 1))
+                    {
+                        continue;
+                    }
+                    tsp_node *new = tsp_node_child(root, i);
+                    new->cost = cost;
+                    new->bound = newBound;
+                    if (search.feasible && !tsp_feasible_child(search.feasible, 0, new))
+                    {
+                        worker.dropped++;
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    if (worker.onetree && (new->bound = tsp_bound_child(worker.onetree, root, new, threshold)) > threshold)
+                    {
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    if (search.dominance && tsp_dominance_insert(search.dominance, new))
+                    {
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    debug("Pushing for thread = %d\n", worker.idx);
+                    tsp_push(&search, &worker, new);
+                }
+            }
+            tsp_delnode(root);
+
+            if (options.scheduler == TSP_SCHEDULER_MULTIQUEUE)
+            {
+                tsp_settle(&search);
+                tsp_run_multiqueue(&search, &worker);
+            }
+            else
+            {
+                tsp_run_steal(&search, &worker);
+            }
+        }
+
+        // No thread leaves before the search is over, so the incumbent is final by now. Of the tours
+        // that cost as much, keep the one every thread would have preferred.
+        double best = tsp_incumbent(&search);
+#pragma omp critical(update_btour)
+        if (worker.found && worker.btourcost == best && (!search.found || tsp_tour_before(rep, worker.btour, search.btour)))
+        {
+            for (size_t i = 0; i < ncities; i++)
+            {
+                search.btour[i] = worker.btour[i];
+            }
+            search.found = true;
+        }
+
+        // Nodes can be freed by any thread, so no pool may go away before every thread is done with them
+#pragma omp barrier
+        tsp_pool_release();
+        if (worker.onetree)
+        {
+            tsp_bound_delete(worker.onetree);
+        }
+#pragma omp atomic update
+        search.expanded += worker.expanded;
+#pragma omp atomic update
+        search.infeasible += worker.dropped;
+        if (worker.endgame)
+        {
+            tsp_endgame_stats stats = tsp_endgame_stats_of(worker.endgame);
+#pragma omp critical(endgame_stats)
+            {
+                search.endgame.solved += stats.solved;
+                search.endgame.completed += stats.completed;
+                search.endgame.lookups += stats.lookups;
+                search.endgame.hits += stats.hits;
+            }
+            tsp_endgame_delete(worker.endgame);
+        }
+        free(worker.tour);
+        free(worker.cities);
+        free(worker.bounds);
+        free(worker.btour);
+    }
+
+    info("Expanded %lu nodes\n", search.expanded);
+    if (search.dominance)
+    {
+        tsp_dominance_stats stats = tsp_dominance_stats_of(search.dominance);
+        (void)stats; // only read by info()
+        info("Dominance table: %zu slots in %.1f MiB, %lu lookups, %.1f%% hits, %lu pruned\n", stats.slots,
+             stats.bytes / 1048576.0, stats.lookups, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0, stats.pruned);
+        tsp_dominance_delete(search.dominance);
+    }
+    if (options.endgame)
+    {
+        info("Endgame: %lu nodes solved, %lu completed, %lu memo lookups, %.1f%% hits\n", search.endgame.solved,
+             search.endgame.completed, search.endgame.lookups, search.endgame.lookups ? 100.0 * search.endgame.hits / search.endgame.lookups : 0.0);
+    }
+    if (search.feasible)
+    {
+        info("Feasibility: %lu nodes dropped\n", search.infeasible);
+        tsp_feasible_delete(search.feasible);
+    }
+    result.tour = search.btour;
+    // Unless a thread found a tour, the heuristic one stands, at its own cost: the incumbent may have
+    // started at limit, below it
+    result.cost = search.found ? tsp_incumbent(&search) : seed;
+
+    if (options.scheduler == TSP_SCHEDULER_MULTIQUEUE)
+    {
+        for (size_t k = 0; k < search.nheaps; k++)
+        {
+            queue_delete(search.heaps[k].queue);
+            free(search.heaps[k].queue);
+            omp_destroy_lock(&search.heaps[k].lock);
+        }
+        free(search.heaps);
+    }
+    else if (options.scheduler == TSP_SCHEDULER_TASKS)
+    {
+        free(search.workers);
+    }
+    else
+    {
+        for (size_t k = 0; k < thread_num; k++)
+        {
+            queue_delete(search.queues[k]);
+            free(search.queues[k]);
+            tsp_deque_delete(search.deques[k]);
+        }
+        free(search.queues);
+        free(search.deques);
+    }
+    pthread_mutex_destroy(&search.park_lock);
+    pthread_cond_destroy(&search.park);
+    if (search.replicas)
+    {
+        for (int k = 0; k < search.nplaces; k++)
+        {
+            tsp_delrepr(search.replicas[k]);
+        }
+        free(search.replicas);
+        free(search.places);
+    }
+
+    return result;
+}
+
+void help(char *me)
+{
+    printf("USAGE: %s inputfile lowerbound [options]\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
+    tsp_options_help(true);
+}
+
+int main(int argc, char *argv[])
+{
+    double limit = INFINITY;
+    double exec_time;
+    // Processor time of every thread together, next to the wall time; the difference is time spent idle
+    double cpu_time;
+    tsp_options options;
+    const char *bad;
+
+    // Argument validation
+    if (argc <= 2)
+    {
+        error("No arguments provided.\n");
+        help(argv[0]);
+        return 1;
+    }
+    else if ((bad = tsp_options_parse(&options, argc, argv, 3, true)))
+    {
+        error("Unknown option: %s\n", bad);
+        help(argv[0]);
+        return 1;
+    }
+
+    // Make sure that the lowerbound arg is a number
+    if (atof(argv[2]) <= 0)
+    {
+        // Either the value is 0 (not allowed) or it is not a number.
+        // If that's the case ignore this.
+        warn("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
+    }
+    else
+    {
+        limit = (double)atof(argv[2]);
+    }
+    info("Cost must be <= %f\n", limit);
+    info("File target: %s\n", argv[1]);
+    FILE *input = fopen(argv[1], "r");
+    if (!input)
+    {
+        syserr("Could not open the input file");
+        return 1;
+    }
+
+    tsp_repr t = tsp_mkrepr(input);
+    if (!t.valid)
+    {
+        // An earlier error happened preventing us from carrying on
+        tsp_delrepr(t);
+        return 1;
+    }
+
+    double lowerbound = 0;
+    for (size_t i = 0; i < t.ncities; ++i)
+    {
+        lowerbound += t.short1[i] + t.short2[i];
+    }
+    lowerbound /= 2;
+    info("Lowerbound at root = %f\n", lowerbound);
+
+    exec_time = -omp_get_wtime();
+    cpu_time = -(double)clock() / CLOCKS_PER_SEC;
+
+    tsp_expand_init();
+    // One heuristic tour serves both the edge elimination and the search
+    unsigned int *btour = arrayi_alloc(t.ncities);
+    double start = omp_get_wtime();
+    double seed = tsp_heuristic(t, btour);
+    (void)start; // only read by info()
+    info("Heuristic tour: %.1f in %.3fs\n", seed, omp_get_wtime() - start);
+    // The reduced graph's bound can come out a rounding error over a tour right on the limit
+    double wholebound = lowerbound;
+    if (options.reduce)
+    {
+        lowerbound = tsp_reduce(&t, limit, seed);
+    }
+    // lowerbound stays as summed in the input's order, which the search on renumbered cities has to match
+    if (options.relabel && !tsp_relabel(&t, btour))
+    {
+        free(btour);
+        tsp_delrepr(t);
+        return 1;
+    }
+    tsp_result result = tsp_exe(t, lowerbound, limit, seed, btour, options);
+    tsp_relabel_tour(t, result.tour);
+
+    exec_time += omp_get_wtime();
+    cpu_time += (double)clock() / CLOCKS_PER_SEC;
+
+    fprintf(stderr, "%.1fs\n", exec_time);
+    fprintf(stderr, "%.1fs CPU\n", cpu_time);
+    if (wholebound > limit)
+    {
+        info("Lowerbound %f is higher than the desired limit %f.\n", wholebound, limit);
+        printf("NO SOLUTION\n");
+    }
+    else if (result.cost > limit)
+    {
+        info("Either the graph is not connected OR the lowerbound limit is too low!\n");
+        printf("NO SOLUTION\n");
+    }
+    else
+    {
+        // Print the tour
+        printf("%.1f\n", result.cost);
+        printf("%d", result.tour[0]);
+        for (size_t i = 1; i < t.ncities; ++i)
+        {
+            printf(" %d", result.tour[i]);
+        }
+        printf(" 0\n");
+    }
+
+    // Cleanup
+    free(result.tour);
+    tsp_delrepr(t);
+    return 0;
+}
@@ -1,34 +1,59 @@
-#ifndef _TSP_QUEUE_H
-#define _TSP_QUEUE_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-
-// A queue where the elements are stored in an increasing order.
-// This implementation uses a binary heap.
-typedef struct
-{
-	void** buffer;
-	size_t size;
-	size_t max_size;
-	char (*cmpfn)(void *, void *);
-} priority_queue_t;
-
-// Create a new priority queue
-priority_queue_t *queue_create(char (*)(void *, void *));
-
-// Delete an existing priority
-void queue_delete(priority_queue_t *queue);
-
-// Insert a new element in the queue and then sort its contents.
-void queue_push(priority_queue_t *queue, void* new_element);
-
-// Return the element with the lowest value in the queue, after removing it.
-void* queue_pop(priority_queue_t *queue);
-
-// Print the contents of the priority queue
-void queue_print(priority_queue_t *queue, FILE *, void (*)(FILE *, void*));
-
-#endif //_TSP_QUEUE_H
+#ifndef _TSP_QUEUE_H
+#define _TSP_QUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// A queue where the elements are stored in an increasing order.
+// This implementation uses a 4-ary heap whose buffer grows geometrically.
+//
+// A queue made by queue_create_buckets is a bucket queue instead: keyfn maps every element to an
+// integer key that never decreases along cmpfn's order, elements with the same key share a bucket,
+// and the buckets form a sliding window over the keys. Pushes are O(1) and pops amortized O(1) as
+// long as few elements share a key. Elements are handed out in exactly cmpfn's order either way.
+struct queue_bucket;
+
+typedef struct
+{
+	void** buffer;
+	size_t size;
+	size_t max_size;
+	char (*cmpfn)(void *, void *);
+
+	// Bucket queues only. In that case buffer holds the spilled elements, the ones whose key fell
+	// outside the window, and size counts every element.
+	long (*keyfn)(void *);
+	struct queue_bucket *buckets;
+	size_t nbuckets;
+	long base;
+	size_t spilled;
+} priority_queue_t;
+
+// Create a new priority queue
+priority_queue_t *queue_create(char (*)(void *, void *));
+
+// Create a new bucket queue
+priority_queue_t *queue_create_buckets(char (*)(void *, void *), long (*)(void *));
+
+// Delete an existing priority
+void queue_delete(priority_queue_t *queue);
+
+// Insert a new element in the queue and then sort its contents.
+void queue_push(priority_queue_t *queue, void* new_element);
+
+// Return the element with the lowest value in the queue, after removing it.
+void* queue_pop(priority_queue_t *queue);
+
+// Return the element with the lowest value in the queue, without removing it (NULL if empty).
+void* queue_top(priority_queue_t *queue);
+
+// Remove every element that does not come strictly before threshold (as decided by cmpfn),
+// handing each one to destructor (if not NULL). Runs in O(n).
+void queue_prune(priority_queue_t *queue, void *threshold, void (*destructor)(void *));
+
+// Print the contents of the priority queue
+void queue_print(priority_queue_t *queue, FILE *, void (*)(FILE *, void*));
+
+#endif //_TSP_QUEUE_H
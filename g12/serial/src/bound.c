@@ -0,0 +1,277 @@
+#include "bound.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heuristic.h"
+#include "matrix.h"
+
+// Subgradient steps at the root, where the penalties start from nothing, and at every other node
+#define ROOT_ITERATIONS 100
+#define NODE_ITERATIONS 8
+
+// Step size, as a fraction of the gap to the upper bound, and how quickly it shrinks
+#define STEP_START 2.0
+#define STEP_DECAY 0.9
+
+// What a node keeps in its extra bytes
+typedef struct
+{
+    double halfsum;
+    float pi[];
+} node_extra;
+
+struct tsp_bound
+{
+    tsp_repr rep;
+    // The unvisited cities, and per position in that list: the penalty, the cheapest edge into
+    // the tree so far, where it comes from, and whether the city is in the tree yet
+    unsigned int *cities;
+    double *pi;
+    double *key;
+    unsigned int *from;
+    bool *intree;
+    // Degree of every unvisited city (by position) in the current 1-tree
+    int *degree;
+};
+
+tsp_bound *tsp_bound_create(tsp_repr rep)
+{
+    tsp_bound *bound = malloc(sizeof(tsp_bound));
+    bound->rep = rep;
+    bound->cities = malloc(rep.ncities * sizeof(unsigned int));
+    bound->pi = malloc(rep.ncities * sizeof(double));
+    bound->key = malloc(rep.ncities * sizeof(double));
+    bound->from = malloc(rep.ncities * sizeof(unsigned int));
+    bound->intree = malloc(rep.ncities * sizeof(bool));
+    bound->degree = malloc(rep.ncities * sizeof(int));
+    return bound;
+}
+
+void tsp_bound_delete(tsp_bound *bound)
+{
+    free(bound->cities);
+    free(bound->pi);
+    free(bound->key);
+    free(bound->from);
+    free(bound->intree);
+    free(bound->degree);
+    free(bound);
+}
+
+size_t tsp_bound_extra(unsigned int ncities)
+{
+    return sizeof(node_extra) + ncities * sizeof(float);
+}
+
+// Weight of an edge between two unvisited cities (given by position) under the penalties
+static double weight(const tsp_bound *b, unsigned int x, unsigned int y)
+{
+    return matrix_read(b->rep.graph, b->rep.ncities, b->cities[x], b->cities[y]) + b->pi[x] + b->pi[y];
+}
+
+// Cheapest and second cheapest penalized edge from city to the unvisited ones (by position)
+static void cheapest(const tsp_bound *b, unsigned int city, unsigned int m, unsigned int *first, unsigned int *second, double *c1, double *c2)
+{
+    *c1 = *c2 = INFINITY;
+    *first = *second = m;
+    for (unsigned int x = 0; x < m; x++)
+    {
+        double w = matrix_read(b->rep.graph, b->rep.ncities, city, b->cities[x]) + b->pi[x];
+        if (w < *c1)
+        {
+            *c2 = *c1;
+            *second = *first;
+            *c1 = w;
+            *first = x;
+        }
+        else if (w < *c2)
+        {
+            *c2 = w;
+            *second = x;
+        }
+    }
+}
+
+// The penalized 1-tree over the m unvisited cities, with here and 0 as the two ends.
+// Fills degree (by position) and returns the Lagrangian bound on the rest of the tour.
+static double onetree(tsp_bound *b, unsigned int here, unsigned int m)
+{
+    double total = 0;
+
+    // Prim's algorithm, dense, since the graphs are
+    for (unsigned int x = 0; x < m; x++)
+    {
+        b->key[x] = INFINITY;
+        b->intree[x] = false;
+        b->degree[x] = 0;
+    }
+    b->key[0] = 0;
+    b->from[0] = m;
+    for (unsigned int added = 0; added < m; added++)
+    {
+        unsigned int next = m;
+        for (unsigned int x = 0; x < m; x++)
+        {
+            if (!b->intree[x] && (next == m || b->key[x] < b->key[next]))
+            {
+                next = x;
+            }
+        }
+        if (b->key[next] == INFINITY)
+        {
+            return INFINITY;
+        }
+
+        b->intree[next] = true;
+        total += b->key[next];
+        if (b->from[next] != m)
+        {
+            b->degree[next]++;
+            b->degree[b->from[next]]++;
+        }
+        for (unsigned int x = 0; x < m; x++)
+        {
+            double w;
+            if (!b->intree[x] && (w = weight(b, next, x)) < b->key[x])
+            {
+                b->key[x] = w;
+                b->from[x] = next;
+            }
+        }
+    }
+
+    // The two ends of the path have to land on different cities, unless only one is left
+    unsigned int h1, h2, z1, z2;
+    double hc1, hc2, zc1, zc2;
+    cheapest(b, here, m, &h1, &h2, &hc1, &hc2);
+    cheapest(b, 0, m, &z1, &z2, &zc1, &zc2);
+    if (h1 == m || z1 == m)
+    {
+        return INFINITY;
+    }
+    if (h1 == z1 && m > 1)
+    {
+        if (hc1 + zc2 <= hc2 + zc1)
+        {
+            z1 = z2;
+            zc1 = zc2;
+        }
+        else
+        {
+            h1 = h2;
+            hc1 = hc2;
+        }
+        if (h1 == m || z1 == m)
+        {
+            return INFINITY;
+        }
+    }
+    b->degree[h1]++;
+    b->degree[z1]++;
+    total += hc1 + zc1;
+
+    for (unsigned int x = 0; x < m; x++)
+    {
+        total -= 2 * b->pi[x];
+    }
+    return total;
+}
+
+double tsp_bound_halfsum(const tsp_node *node)
+{
+    return ((const node_extra *)tsp_node_extra(node))->halfsum;
+}
+
+// A tour only costs its bound to rounding: the penalized sums, or the tour summed the other way
+// round, can come out a hair either side. Just under it, the bound never cuts off a tour that
+// costs exactly the incumbent or the limit.
+static double below(double bound)
+{
+    return bound - TSP_COST_SLACK(bound);
+}
+
+// Subgradient ascent on the penalties of node, starting from start (which may be node's own).
+// Returns the best bound seen, or the half-sum bound if that is higher.
+static double ascend(tsp_bound *b, const float *start, tsp_node *node, unsigned int iterations, double upper)
+{
+    const unsigned int ncities = b->rep.ncities;
+    node_extra *extra = tsp_node_extra(node);
+    float *penalties = extra->pi;
+    unsigned int m = 0;
+
+    extra->halfsum = node->bound;
+
+    for (unsigned int c = 0; c < ncities; c++)
+    {
+        if (!tsp_node_visits(node, c))
+        {
+            b->cities[m] = c;
+            b->pi[m] = start[c];
+            m++;
+        }
+    }
+
+    // Nothing left to span: the tour can only close
+    if (m == 0)
+    {
+        return below(node->cost + matrix_read(b->rep.graph, ncities, node->index, 0));
+    }
+
+    double best = -INFINITY;
+    double step = STEP_START;
+    for (unsigned int it = 0; it < iterations; it++)
+    {
+        double bound = node->cost + onetree(b, node->index, m);
+        if (bound == INFINITY)
+        {
+            return INFINITY;
+        }
+        if (bound > best)
+        {
+            best = bound;
+            for (unsigned int x = 0; x < m; x++)
+            {
+                penalties[b->cities[x]] = b->pi[x];
+            }
+        }
+        if (best > upper)
+        {
+            break;
+        }
+
+        double norm = 0;
+        for (unsigned int x = 0; x < m; x++)
+        {
+            norm += (b->degree[x] - 2) * (b->degree[x] - 2);
+        }
+        // Every city has degree 2: the 1-tree is a tour, and the bound cannot get any better
+        if (norm == 0)
+        {
+            break;
+        }
+
+        // Without a finite upper bound, aim a little above the current one
+        double target = isfinite(upper) ? upper : bound + fabs(bound) * 0.05 + 1;
+        double t = step * (target - bound) / norm;
+        for (unsigned int x = 0; x < m; x++)
+        {
+            b->pi[x] += t * (b->degree[x] - 2);
+        }
+        step *= STEP_DECAY;
+    }
+
+    best = below(best);
+    return best > node->bound ? best : node->bound;
+}
+
+double tsp_bound_root(tsp_bound *bound, tsp_node *root, double upper)
+{
+    return ascend(bound, ((node_extra *)tsp_node_extra(root))->pi, root, ROOT_ITERATIONS, upper);
+}
+
+double tsp_bound_child(tsp_bound *bound, const tsp_node *parent, tsp_node *child, double upper)
+{
+    return ascend(bound, ((const node_extra *)tsp_node_extra(parent))->pi, child, NODE_ITERATIONS, upper);
+}
@@ -0,0 +1,44 @@
+/*
+    Dominance pruning. Two partial tours that visited the same cities and stand on the same city
+    have the same completions, so only the cheaper one can still lead to the best tour. The table
+    remembers the cheapest prefix cost seen for a (visited set, last city) pair; it is a fixed size
+    and direct-mapped, so a newer key simply evicts whatever shared its slot.
+
+    Only strictly dominated nodes are dropped, so equally cheap prefixes are all searched and the
+    tour reported does not change. Breaking symmetry, the second city is part of the key as well,
+    since it decides which completions a node may still take.
+
+    Built with OpenMP (as in tsp-omp) the table is shared: its slots are split into shards with one
+    lock each.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "node.h"
+
+typedef struct tsp_dominance tsp_dominance;
+
+typedef struct
+{
+    size_t slots;
+    size_t bytes;
+    unsigned long lookups;
+    // Lookups that found their own key in the table
+    unsigned long hits;
+    // Nodes dropped for being dominated
+    unsigned long pruned;
+} tsp_dominance_stats;
+
+// A table of at most megabytes MiB over ncities cities, keyed on the second city too when symmetry is set
+tsp_dominance *tsp_dominance_create(unsigned int ncities, size_t megabytes, bool symmetry);
+void tsp_dominance_delete(tsp_dominance *table);
+
+// Whether a cheaper prefix already reached the state of node; if not, node is recorded as the best one
+bool tsp_dominance_insert(tsp_dominance *table, const tsp_node *node);
+
+// Whether a cheaper prefix has reached the state of node since it was recorded (the table is left as is)
+bool tsp_dominance_stale(tsp_dominance *table, const tsp_node *node);
+
+tsp_dominance_stats tsp_dominance_stats_of(const tsp_dominance *table);
@@ -0,0 +1,196 @@
+#include "expand.h"
+
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXPAND_X86 1
+#endif
+
+typedef unsigned int (*expand_kernel)(const double *, const uint64_t *, unsigned int, double, double, unsigned int *, double *);
+
+// Cities [from, ncities), one at a time. Also finishes the rows that the vector kernels leave over.
+static unsigned int expand_scalar(const double *delta, const uint64_t *visited, unsigned int from, unsigned int ncities,
+                                  double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    unsigned int n = 0;
+
+    for (unsigned int i = from; i < ncities; i++)
+    {
+        double child = bound + delta[i];
+        if ((visited[i / 64] >> (i % 64)) & 1 || delta[i] == INFINITY || child > threshold)
+        {
+            continue;
+        }
+        cities[n] = i;
+        bounds[n] = child;
+        n++;
+    }
+
+    return n;
+}
+
+static unsigned int expand_c(const double *delta, const uint64_t *visited, unsigned int ncities,
+                             double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    return expand_scalar(delta, visited, 0, ncities, bound, threshold, cities, bounds);
+}
+
+#ifdef EXPAND_X86
+// Unvisited cities among [i, i + width), one bit each. The chunks never straddle a word.
+static inline unsigned int unvisited_bits(const uint64_t *visited, unsigned int i, unsigned int width)
+{
+    return (unsigned int)(~visited[i / 64] >> (i % 64)) & ((1u << width) - 1);
+}
+
+__attribute__((target("avx2"))) static unsigned int expand_avx2(const double *delta, const uint64_t *visited, unsigned int ncities,
+                                                                 double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    const __m256d base = _mm256_set1_pd(bound);
+    const __m256d limit = _mm256_set1_pd(threshold);
+    const __m256d missing = _mm256_set1_pd(INFINITY);
+    unsigned int n = 0, i = 0;
+
+    for (; i + 4 <= ncities; i += 4)
+    {
+        unsigned int open = unvisited_bits(visited, i, 4);
+        if (!open)
+        {
+            continue;
+        }
+
+        __m256d d = _mm256_loadu_pd(delta + i);
+        __m256d child = _mm256_add_pd(base, d);
+        __m256d keep = _mm256_and_pd(_mm256_cmp_pd(child, limit, _CMP_LE_OQ), _mm256_cmp_pd(d, missing, _CMP_LT_OQ));
+        unsigned int mask = open & (unsigned int)_mm256_movemask_pd(keep);
+        if (!mask)
+        {
+            continue;
+        }
+
+        double lanes[4];
+        _mm256_storeu_pd(lanes, child);
+        while (mask)
+        {
+            unsigned int k = __builtin_ctz(mask);
+            mask &= mask - 1;
+            cities[n] = i + k;
+            bounds[n] = lanes[k];
+            n++;
+        }
+    }
+
+    return n + expand_scalar(delta, visited, i, ncities, bound, threshold, cities + n, bounds + n);
+}
+
+__attribute__((target("avx512f"))) static unsigned int expand_avx512(const double *delta, const uint64_t *visited, unsigned int ncities,
+                                                                      double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    const __m512d base = _mm512_set1_pd(bound);
+    const __m512d limit = _mm512_set1_pd(threshold);
+    const __m512d missing = _mm512_set1_pd(INFINITY);
+    const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    unsigned int n = 0, i = 0;
+
+    for (; i + 8 <= ncities; i += 8)
+    {
+        __mmask8 open = (__mmask8)unvisited_bits(visited, i, 8);
+        if (!open)
+        {
+            continue;
+        }
+
+        __m512d d = _mm512_loadu_pd(delta + i);
+        __m512d child = _mm512_add_pd(base, d);
+        __mmask8 keep = _mm512_mask_cmp_pd_mask(open, child, limit, _CMP_LE_OQ);
+        keep = _mm512_mask_cmp_pd_mask(keep, d, missing, _CMP_LT_OQ);
+        if (!keep)
+        {
+            continue;
+        }
+
+        // Survivors are packed to the front, so their cities and bounds can be stored in one go
+        unsigned int count = __builtin_popcount(keep);
+        uint64_t found[8];
+        _mm512_mask_compressstoreu_pd(bounds + n, keep, child);
+        _mm512_mask_compressstoreu_epi64(found, keep, _mm512_add_epi64(lane, _mm512_set1_epi64(i)));
+        for (unsigned int k = 0; k < count; k++)
+        {
+            cities[n + k] = (unsigned int)found[k];
+        }
+        n += count;
+    }
+
+    return n + expand_scalar(delta, visited, i, ncities, bound, threshold, cities + n, bounds + n);
+}
+#endif
+
+static expand_kernel kernel = expand_c;
+
+void tsp_expand_init(void)
+{
+#ifdef EXPAND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        kernel = expand_avx512;
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        kernel = expand_avx2;
+    }
+#endif
+}
+
+unsigned int tsp_expand(const double *delta, const uint64_t *visited, unsigned int ncities,
+                        double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    return kernel(delta, visited, ncities, bound, threshold, cities, bounds);
+}
+
+// Neighbours come smallest delta first, so the first one over threshold ends the walk
+static unsigned int expand_sorted(const unsigned int *adjcity, const double *adjdelta, unsigned int degree, const uint64_t *visited,
+                                  double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    unsigned int n = 0;
+
+    for (unsigned int e = 0; e < degree; e++)
+    {
+        double child = bound + adjdelta[e];
+        if (child > threshold)
+        {
+            break;
+        }
+        unsigned int c = adjcity[e];
+        if ((visited[c / 64] >> (c % 64)) & 1)
+        {
+            continue;
+        }
+
+        // Back into city order; there are seldom more than a handful
+        unsigned int k = n++;
+        while (k > 0 && cities[k - 1] > c)
+        {
+            cities[k] = cities[k - 1];
+            bounds[k] = bounds[k - 1];
+            k--;
+        }
+        cities[k] = c;
+        bounds[k] = child;
+    }
+
+    return n;
+}
+
+unsigned int tsp_expand_city(const tsp_repr *rep, unsigned int city, const uint64_t *visited,
+                             double bound, double threshold, unsigned int *cities, double *bounds)
+{
+    unsigned int start = rep->adjstart[city];
+    unsigned int degree = rep->adjstart[city + 1] - start;
+    // A dense row is as quick to sweep whole with the vector kernel
+    if (2 * degree <= rep->ncities)
+    {
+        return expand_sorted(rep->adjcity + start, rep->adjdelta + start, degree, visited, bound, threshold, cities, bounds);
+    }
+    return kernel(rep->delta + (size_t)city * rep->ncities, visited, rep->ncities, bound, threshold, cities, bounds);
+}
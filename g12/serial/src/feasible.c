@@ -0,0 +1,101 @@
+#include "feasible.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "matrix.h"
+
+// Levels between reachability checks. A city cut off stays cut off, so skipping levels only lets a
+// doomed node live a little longer, and the degree checks already catch most of them.
+#define REACH_EVERY 4
+
+struct tsp_feasible
+{
+    unsigned int ncities;
+    uint64_t adj[];
+};
+
+tsp_feasible *tsp_feasible_create(tsp_repr rep)
+{
+    if (rep.ncities > 64)
+    {
+        warn("The feasibility checks only handle up to 64 cities; going without.\n");
+        return NULL;
+    }
+
+    tsp_feasible *feasible = calloc(1, sizeof(tsp_feasible) + rep.ncities * sizeof(uint64_t));
+    if (!feasible)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    feasible->ncities = rep.ncities;
+    for (unsigned int i = 0; i < rep.ncities; i++)
+    {
+        for (unsigned int j = 0; j < rep.ncities; j++)
+        {
+            if (matrix_read(rep.graph, rep.ncities, i, j) != INFINITY)
+            {
+                feasible->adj[i] |= (uint64_t)1 << j;
+            }
+        }
+    }
+    return feasible;
+}
+
+void tsp_feasible_delete(tsp_feasible *feasible)
+{
+    free(feasible);
+}
+
+bool tsp_feasible_child(const tsp_feasible *feasible, unsigned int from, const tsp_node *node)
+{
+    const uint64_t *adj = feasible->adj;
+    // Padding bits are set in the visited set, so this only holds real cities
+    uint64_t open = ~tsp_node_visited(node)[0];
+    if (!open)
+    {
+        // Closing the tour is up to the caller
+        return true;
+    }
+
+    unsigned int last = node->index;
+    if (!(adj[last] & open) || !(adj[0] & open))
+    {
+        return false;
+    }
+
+    // Only from has stopped being an end since the parent, so only its neighbours can have lost an
+    // edge. Nothing checked the root though, so its children (from is 0) go through every city.
+    uint64_t usable = open | (uint64_t)1 << last | 1;
+    for (uint64_t left = from ? adj[from] & open : open; left; left &= left - 1)
+    {
+        unsigned int c = __builtin_ctzll(left);
+        if (__builtin_popcountll(adj[c] & usable) < 2)
+        {
+            return false;
+        }
+    }
+
+    if (node->length % REACH_EVERY != 0)
+    {
+        return true;
+    }
+
+    // Everything left has to be reachable from last through cities still to visit
+    uint64_t seen = adj[last] & open, frontier = seen;
+    while (frontier)
+    {
+        uint64_t next = 0;
+        for (; frontier; frontier &= frontier - 1)
+        {
+            next |= adj[__builtin_ctzll(frontier)];
+        }
+        frontier = next & open & ~seen;
+        seen |= frontier;
+    }
+    return seen == open;
+}
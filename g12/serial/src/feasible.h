@@ -0,0 +1,25 @@
+/*
+    Feasibility checks for sparse graphs. A partial tour from 0 to its last city can only be closed
+    if every city still to visit has two edges left to use (to other such cities or to either end of
+    the tour), both ends have an edge into those cities, and they can all be reached from the last
+    city (looked at every few levels only). Nodes that fail any of these are dropped before their
+    subtree is searched.
+
+    The graph is kept as one adjacency bitset per city, so instances of up to 64 cities only.
+*/
+
+#pragma once
+#include <stdbool.h>
+
+#include "node.h"
+#include "repr.h"
+
+typedef struct tsp_feasible tsp_feasible;
+
+// Returns NULL (and warns) when the instance is too large for it
+tsp_feasible *tsp_feasible_create(tsp_repr rep);
+void tsp_feasible_delete(tsp_feasible *feasible);
+
+// Whether node, just made a child of a node ending at from that passed this check itself, can still
+// be closed into a tour. Only the cities next to from are checked again for their edges.
+bool tsp_feasible_child(const tsp_feasible *feasible, unsigned int from, const tsp_node *node);
@@ -0,0 +1,81 @@
+#include "frontier.h"
+
+#include <limits.h>
+
+#include "lib/nqueue/queue.h"
+
+#ifndef TSP_BUCKETS
+#define TSP_BUCKETS 0
+#endif
+
+struct frontier
+{
+    priority_queue_t *queue;
+};
+
+char tsp_queue_cmp(void *a, void *b)
+{
+    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
+    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
+    {
+        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
+    }
+
+    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
+}
+
+#if TSP_BUCKETS
+// Input costs have a single decimal digit, so bounds are multiples of 0.05 and land on distinct keys.
+// Rounding keeps the key monotone in the bound; ties on a key are still ordered by tsp_queue_cmp.
+static long tsp_queue_key(void *a)
+{
+    double key = ((tsp_node *)a)->bound * 20;
+    return key < LONG_MAX / 2 ? (long)(key + 0.5) : LONG_MAX / 2;
+}
+#endif
+
+static void frontier_delnode(void *node)
+{
+    tsp_delnode(node);
+}
+
+frontier_t *frontier_create(void)
+{
+    frontier_t *frontier = malloc(sizeof(frontier_t));
+#if TSP_BUCKETS
+    frontier->queue = queue_create_buckets(tsp_queue_cmp, tsp_queue_key);
+#else
+    frontier->queue = queue_create(tsp_queue_cmp);
+#endif
+    return frontier;
+}
+
+void frontier_delete(frontier_t *frontier)
+{
+    queue_delete(frontier->queue);
+    free(frontier->queue);
+    free(frontier);
+}
+
+size_t frontier_size(const frontier_t *frontier)
+{
+    return frontier->queue->size;
+}
+
+void frontier_push(frontier_t *frontier, tsp_node *node)
+{
+    queue_push(frontier->queue, node);
+}
+
+tsp_node *frontier_pop(frontier_t *frontier)
+{
+    return queue_pop(frontier->queue);
+}
+
+void frontier_prune(frontier_t *frontier, double bound, bool ties)
+{
+    // Index 0 makes nodes that tie with the bound sort after the threshold, so they go too;
+    // the largest index keeps them in front of it
+    tsp_node threshold = {.bound = bound, .index = ties ? UINT_MAX : 0};
+    queue_prune(frontier->queue, &threshold, frontier_delnode);
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#include "frontier.h"
+}
+
+#include "lib/nqueue/queue.hpp"
+
+namespace
+{
+    // The heap holds the sort key next to the node handle, so sifting stays inside one array
+    struct entry
+    {
+        double bound;
+        unsigned int index;
+        tsp_node *node;
+    };
+
+    struct entry_cmp
+    {
+        bool operator()(const entry &a, const entry &b) const
+        {
+            // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
+            if (a.bound == b.bound)
+            {
+                return a.index > b.index;
+            }
+
+            return a.bound > b.bound;
+        }
+    };
+}
+
+struct frontier
+{
+    PriorityQueue<entry, entry_cmp> queue;
+};
+
+frontier_t *frontier_create(void)
+{
+    return new frontier();
+}
+
+void frontier_delete(frontier_t *frontier)
+{
+    delete frontier;
+}
+
+size_t frontier_size(const frontier_t *frontier)
+{
+    return frontier->queue.size();
+}
+
+void frontier_push(frontier_t *frontier, tsp_node *node)
+{
+    frontier->queue.push(entry{node->bound, node->index, node});
+}
+
+tsp_node *frontier_pop(frontier_t *frontier)
+{
+    return frontier->queue.pop().node;
+}
+
+void frontier_prune(frontier_t *frontier, double bound, bool ties)
+{
+    // Index 0 makes nodes that tie with the bound sort after the threshold, so they go too;
+    // the largest index keeps them in front of it
+    frontier->queue.prune(entry{bound, ties ? UINT_MAX : 0, nullptr}, [](const entry &e) { tsp_delnode(e.node); });
+}
@@ -0,0 +1,32 @@
+/*
+    The set of open nodes of the serial search, always handing out the node with the lowest bound
+    (ties go to the lowest index).
+    frontier.c keeps nodes in the C priority_queue_t; frontier.cpp (make cpp) keeps (bound, index, node)
+    entries by value in the PriorityQueue template, so the comparisons never chase node pointers.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "node.h"
+
+typedef struct frontier frontier_t;
+
+// Create an empty frontier
+frontier_t *frontier_create(void);
+
+// Delete the frontier (nodes still in it are not freed)
+void frontier_delete(frontier_t *frontier);
+
+// Number of nodes in the frontier
+size_t frontier_size(const frontier_t *frontier);
+
+// Insert a node
+void frontier_push(frontier_t *frontier, tsp_node *node);
+
+// Remove and return the node with the lowest (bound, index)
+tsp_node *frontier_pop(frontier_t *frontier);
+
+// Delete every node whose bound is not below the given bound (or, with ties set, above it)
+void frontier_prune(frontier_t *frontier, double bound, bool ties);
@@ -0,0 +1,383 @@
+#include "mirror.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "heuristic.h"
+#include "matrix.h"
+
+struct tsp_mirror_pool
+{
+    tsp_repr rep;
+    double lowerbound;
+    double upper;
+    // The cheapest cost offered so far
+    double best;
+    size_t count;
+    size_t capacity;
+    tsp_mirror_key *keys;
+    // count tours of rep.ncities cities each
+    unsigned int *tours;
+    unsigned int *scratch;
+};
+
+// The two highest cities not on the tour yet (UINT_MAX where there are not that many)
+static void highest_unvisited(const tsp_node *node, unsigned int ncities, unsigned int *hi, unsigned int *hi2)
+{
+    const uint64_t *visited = tsp_node_visited(node);
+
+    *hi = *hi2 = UINT_MAX;
+    for (unsigned int w = TSP_SET_WORDS(ncities); w-- > 0;)
+    {
+        uint64_t left = ~visited[w];
+        while (left)
+        {
+            unsigned int city = w * 64 + 63 - __builtin_clzll(left);
+            left &= ~((uint64_t)1 << (city % 64));
+            if (*hi == UINT_MAX)
+            {
+                *hi = city;
+            }
+            else
+            {
+                *hi2 = city;
+                return;
+            }
+        }
+    }
+}
+
+unsigned int tsp_mirror_filter(const tsp_node *node, unsigned int ncities, unsigned int *cities, double *bounds, unsigned int found)
+{
+    // With fewer than three cities a tour is its own mirror
+    if (ncities < 3)
+    {
+        return found;
+    }
+
+    unsigned int hi, hi2, kept = 0;
+    highest_unvisited(node, ncities, &hi, &hi2);
+
+    for (unsigned int k = 0; k < found; k++)
+    {
+        unsigned int city = cities[k];
+        unsigned int second = node->length == 1 ? city : tsp_node_second(node);
+
+        // A complete tour has to end above its second city; anything else needs a city left that can
+        bool keep;
+        if (node->length + 1 == ncities)
+        {
+            keep = city > second;
+        }
+        else
+        {
+            unsigned int top = city == hi ? hi2 : hi;
+            keep = top != UINT_MAX && top > second;
+        }
+
+        if (keep)
+        {
+            cities[kept] = city;
+            bounds[kept] = bounds[k];
+            kept++;
+        }
+    }
+
+    return kept;
+}
+
+tsp_mirror_key tsp_mirror_key_of(tsp_repr rep, double lowerbound, const unsigned int *tour, bool reversed)
+{
+    const unsigned int n = rep.ncities;
+    tsp_mirror_key key = {.cost = 0, .bound = lowerbound, .index = 0};
+
+    // Accumulate in the same order as the search does, so that the sums come out bit for bit
+    for (unsigned int i = 1; i < n; i++)
+    {
+        unsigned int city = reversed ? tour[n - i] : tour[i];
+        key.cost += matrix_read(rep.graph, n, key.index, city);
+        key.bound += matrix_read(rep.delta, n, key.index, city);
+        key.index = city;
+    }
+    key.cost += matrix_read(rep.graph, n, key.index, 0);
+    // The search that is being stood in for numbered the cities as the input did
+    key.index = tsp_repr_label(rep, key.index);
+
+    return key;
+}
+
+void tsp_mirror_reverse(unsigned int *tour, unsigned int ncities)
+{
+    for (unsigned int lo = 1, hi = ncities - 1; lo < hi; lo++, hi--)
+    {
+        unsigned int swap = tour[lo];
+        tour[lo] = tour[hi];
+        tour[hi] = swap;
+    }
+}
+
+tsp_mirror_pool *tsp_mirror_pool_create(tsp_repr rep, double lowerbound, double upper)
+{
+    tsp_mirror_pool *pool = malloc(sizeof(tsp_mirror_pool));
+    pool->rep = rep;
+    pool->lowerbound = lowerbound;
+    pool->upper = upper;
+    pool->best = INFINITY;
+    pool->count = 0;
+    pool->capacity = 8;
+    pool->keys = malloc(pool->capacity * sizeof(tsp_mirror_key));
+    pool->tours = malloc(pool->capacity * rep.ncities * sizeof(unsigned int));
+    pool->scratch = malloc(rep.ncities * sizeof(unsigned int));
+    if (!pool->keys || !pool->tours || !pool->scratch)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    return pool;
+}
+
+void tsp_mirror_pool_delete(tsp_mirror_pool *pool)
+{
+    free(pool->keys);
+    free(pool->tours);
+    free(pool->scratch);
+    free(pool);
+}
+
+void tsp_mirror_add(tsp_mirror_pool *pool, tsp_mirror_key key, const unsigned int *tour)
+{
+    const unsigned int n = pool->rep.ncities;
+
+    if (key.cost >= pool->upper || key.cost > pool->best + TSP_COST_SLACK(pool->best))
+    {
+        return;
+    }
+    if (key.cost < pool->best)
+    {
+        // Whatever no longer comes close to the cheapest tour can never be taken over it
+        pool->best = key.cost;
+        size_t kept = 0;
+        for (size_t i = 0; i < pool->count; i++)
+        {
+            if (pool->keys[i].cost <= pool->best + TSP_COST_SLACK(pool->best))
+            {
+                pool->keys[kept] = pool->keys[i];
+                memmove(pool->tours + kept * n, pool->tours + i * n, n * sizeof(unsigned int));
+                kept++;
+            }
+        }
+        pool->count = kept;
+    }
+
+    if (pool->count == pool->capacity)
+    {
+        pool->capacity *= 2;
+        pool->keys = realloc(pool->keys, pool->capacity * sizeof(tsp_mirror_key));
+        pool->tours = realloc(pool->tours, pool->capacity * n * sizeof(unsigned int));
+        if (!pool->keys || !pool->tours)
+        {
+            error("Failed to allocate memory; aborting!\n");
+            exit(1);
+        }
+    }
+    pool->keys[pool->count] = key;
+    memcpy(pool->tours + pool->count * n, tour, n * sizeof(unsigned int));
+    pool->count++;
+}
+
+double tsp_mirror_offer(tsp_mirror_pool *pool, const unsigned int *tour, double limit)
+{
+    const unsigned int n = pool->rep.ncities;
+    tsp_mirror_key key = tsp_mirror_key_of(pool->rep, pool->lowerbound, tour, false);
+    tsp_mirror_key back = tsp_mirror_key_of(pool->rep, pool->lowerbound, tour, true);
+
+    // The full search never completes a node whose bound is above the limit
+    if (key.bound <= limit)
+    {
+        tsp_mirror_add(pool, key, tour);
+    }
+    if (back.bound <= limit)
+    {
+        memcpy(pool->scratch, tour, n * sizeof(unsigned int));
+        tsp_mirror_reverse(pool->scratch, n);
+        tsp_mirror_add(pool, back, pool->scratch);
+    }
+
+    double cutoff = pool->best + TSP_COST_SLACK(pool->best);
+    return cutoff < pool->upper ? cutoff : pool->upper;
+}
+
+size_t tsp_mirror_count(const tsp_mirror_pool *pool)
+{
+    return pool->count;
+}
+
+tsp_mirror_key tsp_mirror_key_at(const tsp_mirror_pool *pool, size_t i)
+{
+    return pool->keys[i];
+}
+
+const unsigned int *tsp_mirror_tour_at(const tsp_mirror_pool *pool, size_t i)
+{
+    return pool->tours + i * pool->rep.ncities;
+}
+
+#define NONE SIZE_MAX
+
+// A node of the full search on the way to one of the tours kept
+typedef struct
+{
+    unsigned int city;
+    double bound;
+    // When it was pushed, which breaks ties between nodes of the same bound and city
+    size_t pushed;
+    size_t child;
+    size_t sibling;
+    // The tour kept that this node completes, or NONE
+    size_t entry;
+} trail;
+
+typedef struct
+{
+    const tsp_mirror_pool *pool;
+    trail *nodes;
+    size_t *heap;
+    size_t size;
+} replay;
+
+// Whether node a is popped after node b, as tsp_queue_cmp has it. Ties on both the bound and the
+// city are taken first in first out.
+static bool popped_after(const replay *r, size_t a, size_t b)
+{
+    const trail *x = r->nodes + a, *y = r->nodes + b;
+    if (x->bound != y->bound)
+    {
+        return x->bound > y->bound;
+    }
+    unsigned int cx = tsp_repr_label(r->pool->rep, x->city), cy = tsp_repr_label(r->pool->rep, y->city);
+    if (cx != cy)
+    {
+        return cx > cy;
+    }
+    return x->pushed > y->pushed;
+}
+
+static void replay_push(replay *r, size_t node)
+{
+    size_t i = r->size++;
+    while (i > 0 && popped_after(r, r->heap[(i - 1) / 2], node))
+    {
+        r->heap[i] = r->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    r->heap[i] = node;
+}
+
+static size_t replay_pop(replay *r)
+{
+    size_t top = r->heap[0], last = r->heap[--r->size], i = 0;
+    for (size_t c; (c = 2 * i + 1) < r->size; i = c)
+    {
+        if (c + 1 < r->size && popped_after(r, r->heap[c], r->heap[c + 1]))
+        {
+            c++;
+        }
+        if (!popped_after(r, last, r->heap[c]))
+        {
+            break;
+        }
+        r->heap[i] = r->heap[c];
+    }
+    r->heap[i] = last;
+    return top;
+}
+
+tsp_mirror_key tsp_mirror_pick(tsp_mirror_pool *pool, unsigned int *tour)
+{
+    const unsigned int n = pool->rep.ncities;
+    tsp_mirror_key taken = {.cost = INFINITY, .bound = INFINITY, .index = UINT_MAX};
+    if (pool->count == 0)
+    {
+        return taken;
+    }
+
+    // Lay the tours out as the part of the search tree that leads to them
+    replay r = {.pool = pool, .size = 0};
+    r.nodes = malloc((pool->count * (n - 1) + 1) * sizeof(trail));
+    r.heap = malloc((pool->count * (n - 1) + 1) * sizeof(size_t));
+    if (!r.nodes || !r.heap)
+    {
+        error("Failed to allocate memory; aborting!\n");
+        exit(1);
+    }
+    size_t used = 1;
+    r.nodes[0] = (trail){.city = 0, .bound = pool->lowerbound, .child = NONE, .sibling = NONE, .entry = NONE};
+    for (size_t e = 0; e < pool->count; e++)
+    {
+        const unsigned int *t = tsp_mirror_tour_at(pool, e);
+        size_t at = 0;
+        for (unsigned int i = 1; i < n; i++)
+        {
+            size_t next = r.nodes[at].child;
+            while (next != NONE && r.nodes[next].city != t[i])
+            {
+                next = r.nodes[next].sibling;
+            }
+            if (next == NONE)
+            {
+                next = used++;
+                // Summed as the search does, so that the bounds come out bit for bit
+                r.nodes[next] = (trail){.city = t[i],
+                                        .bound = r.nodes[at].bound + matrix_read(pool->rep.delta, n, r.nodes[at].city, t[i]),
+                                        .child = NONE,
+                                        .sibling = r.nodes[at].child,
+                                        .entry = NONE};
+                r.nodes[at].child = next;
+            }
+            at = next;
+        }
+        // The same tour kept twice can only be taken the first time
+        if (r.nodes[at].entry == NONE)
+        {
+            r.nodes[at].entry = e;
+        }
+    }
+
+    // Replay the full search: a complete node is taken if it is cheaper than the incumbent, unless
+    // its bound already reaches the incumbent's cost and has it dropped
+    double incumbent = pool->upper;
+    size_t chosen = NONE, pushed = 0;
+    r.nodes[0].pushed = pushed++;
+    replay_push(&r, 0);
+    while (r.size)
+    {
+        const trail *node = r.nodes + replay_pop(&r);
+        if (node->entry != NONE)
+        {
+            tsp_mirror_key key = pool->keys[node->entry];
+            if (key.bound < incumbent && key.cost < incumbent)
+            {
+                incumbent = key.cost;
+                taken = key;
+                chosen = node->entry;
+            }
+        }
+        for (size_t c = node->child; c != NONE; c = r.nodes[c].sibling)
+        {
+            r.nodes[c].pushed = pushed++;
+            replay_push(&r, c);
+        }
+    }
+    free(r.nodes);
+    free(r.heap);
+
+    if (chosen != NONE)
+    {
+        memcpy(tour, tsp_mirror_tour_at(pool, chosen), n * sizeof(unsigned int));
+    }
+    return taken;
+}
@@ -0,0 +1,110 @@
+/*
+    Search tree nodes. Each node is a single block followed by a bitset of the cities already on the
+    tour (one 64-bit word covers up to 64 cities).
+    Blocks are carved out of slabs, with one size class per tour length, and recycled through
+    a thread-local free list so that expanding a node never goes through malloc/free.
+
+    By default every node stores its partial tour inline. When built with TSP_PREFIX=1 a node only
+    keeps its last city and a reference-counted pointer to its parent, so siblings share their
+    prefix; the tour is only rebuilt (tsp_node_tour) when it is actually needed.
+*/
+
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef TSP_PREFIX
+#define TSP_PREFIX 0
+#endif
+
+#if TSP_PREFIX
+typedef struct tsp_node
+{
+    double cost;
+    double bound;
+    unsigned int length;
+    unsigned int index;
+    struct tsp_node *parent;
+    unsigned int refs;
+    // tour[1], kept in what would otherwise be padding so that it never takes a walk up the parents
+    unsigned int second;
+    uint64_t visited[];
+} tsp_node;
+#else
+typedef struct
+{
+    double cost;
+    double bound;
+    unsigned int length;
+    unsigned int index;
+    unsigned int tour[];
+} tsp_node;
+#endif
+
+// Number of 64-bit words in a visited set over ncities cities
+#define TSP_SET_WORDS(ncities) (((ncities) + 63) / 64)
+
+// Set up the calling thread's node pool for tours of up to ncities cities.
+// Every node also gets extra bytes of scratch for the bound (see tsp_node_extra).
+void tsp_pool_init(unsigned int ncities, size_t extra);
+
+// Give the calling thread's slabs back to the system.
+// Every node allocated by this thread must be dead (and no other thread may still free into it).
+void tsp_pool_release(void);
+
+// Bytes taken by a node holding a tour of the given length
+size_t tsp_node_size(unsigned int length);
+
+// Allocate a node with room for a tour of the given length (node->length is set)
+tsp_node *tsp_mknode(unsigned int length);
+
+// Drop a reference to a node, returning it to the calling thread's pool once nothing uses it
+void tsp_delnode(tsp_node *node);
+
+// The tour [0] at the root of the search
+tsp_node *tsp_node_root(double bound);
+
+// A node extending parent with city; cost and bound are left for the caller
+tsp_node *tsp_node_child(tsp_node *parent, unsigned int city);
+
+// Write the partial tour of node into tour[0...length-1]
+void tsp_node_tour(const tsp_node *node, unsigned int *tour);
+
+// Bytes needed to send a node with a tour of up to ncities cities to another process
+size_t tsp_node_packsize(unsigned int ncities);
+
+// Flatten node (header, tour and extra bytes) into buffer
+void tsp_node_pack(const tsp_node *node, char *buffer);
+
+// Rebuild a node from a buffer filled by tsp_node_pack
+tsp_node *tsp_node_unpack(const char *buffer);
+
+// The extra bytes of a node, after its visited set. They start zeroed at the root, travel with
+// tsp_node_pack, and are left for the caller by tsp_node_child.
+void *tsp_node_extra(const tsp_node *node);
+
+// Bits past the last city are always set, so ~visited only ever yields real cities.
+static inline uint64_t *tsp_node_visited(const tsp_node *node)
+{
+#if TSP_PREFIX
+    return (uint64_t *)node->visited;
+#else
+    // The visited set sits right after the tour, padded to a whole number of words
+    return (uint64_t *)(node->tour + ((node->length + 1) & ~1u));
+#endif
+}
+
+// The second city on the tour; only meaningful once the tour has one
+static inline unsigned int tsp_node_second(const tsp_node *node)
+{
+#if TSP_PREFIX
+    return node->second;
+#else
+    return node->tour[1];
+#endif
+}
+
+static inline int tsp_node_visits(const tsp_node *node, unsigned int city)
+{
+    return (tsp_node_visited(node)[city / 64] >> (city % 64)) & 1;
+}
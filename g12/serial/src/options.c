@@ -0,0 +1,216 @@
+#include "options.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// If arg is --key=value for the given key, return the value
+static const char *option_value(const char *arg, const char *key)
+{
+    size_t len = strlen(key);
+    if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, key, len) != 0 || arg[2 + len] != '=')
+    {
+        return NULL;
+    }
+    return arg + 3 + len;
+}
+
+// Read a whole non-negative number
+static bool option_number(const char *value, unsigned long *number)
+{
+    char *end;
+    if (!isdigit((unsigned char)*value))
+    {
+        return false;
+    }
+    *number = strtoul(value, &end, 10);
+    return *end == '\0';
+}
+
+const char *tsp_options_parse(tsp_options *options, int argc, char *argv[], int first, bool threads)
+{
+    options->bound = TSP_BOUND_HALFSUM;
+    options->symmetry = false;
+    options->dominance = 0;
+    options->endgame = 0;
+    options->feasibility = false;
+    options->reduce = false;
+    options->relabel = false;
+    options->scheduler = TSP_SCHEDULER_STEAL;
+    options->task_depth = TSP_TASK_DEPTH;
+    options->task_grain = TSP_TASK_GRAIN;
+    options->numa = false;
+
+    for (int i = first; i < argc; i++)
+    {
+        const char *value;
+        unsigned long number;
+        if ((value = option_value(argv[i], "bound")))
+        {
+            if (strcmp(value, "halfsum") == 0)
+            {
+                options->bound = TSP_BOUND_HALFSUM;
+            }
+            else if (strcmp(value, "1tree") == 0)
+            {
+                options->bound = TSP_BOUND_ONETREE;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if ((value = option_value(argv[i], "symmetry")))
+        {
+            if (strcmp(value, "keep") == 0)
+            {
+                options->symmetry = false;
+            }
+            else if (strcmp(value, "break") == 0)
+            {
+                options->symmetry = true;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if ((value = option_value(argv[i], "dominance")))
+        {
+            if (!option_number(value, &number))
+            {
+                return argv[i];
+            }
+            options->dominance = number;
+        }
+        else if ((value = option_value(argv[i], "endgame")))
+        {
+            if (!option_number(value, &number) || number > TSP_ENDGAME_MAX)
+            {
+                return argv[i];
+            }
+            options->endgame = number;
+        }
+        else if ((value = option_value(argv[i], "feasibility")))
+        {
+            if (strcmp(value, "off") == 0)
+            {
+                options->feasibility = false;
+            }
+            else if (strcmp(value, "check") == 0)
+            {
+                options->feasibility = true;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if ((value = option_value(argv[i], "reduce")))
+        {
+            if (strcmp(value, "off") == 0)
+            {
+                options->reduce = false;
+            }
+            else if (strcmp(value, "edges") == 0)
+            {
+                options->reduce = true;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if ((value = option_value(argv[i], "relabel")))
+        {
+            if (strcmp(value, "off") == 0)
+            {
+                options->relabel = false;
+            }
+            else if (strcmp(value, "nearest") == 0)
+            {
+                options->relabel = true;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if (threads && (value = option_value(argv[i], "scheduler")))
+        {
+            if (strcmp(value, "steal") == 0)
+            {
+                options->scheduler = TSP_SCHEDULER_STEAL;
+            }
+            else if (strcmp(value, "multiqueue") == 0)
+            {
+                options->scheduler = TSP_SCHEDULER_MULTIQUEUE;
+            }
+            else if (strcmp(value, "tasks") == 0)
+            {
+                options->scheduler = TSP_SCHEDULER_TASKS;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else if (threads && (value = option_value(argv[i], "task-depth")))
+        {
+            if (!option_number(value, &number) || number < 2)
+            {
+                return argv[i];
+            }
+            options->task_depth = number;
+        }
+        else if (threads && (value = option_value(argv[i], "task-grain")))
+        {
+            if (!option_number(value, &number))
+            {
+                return argv[i];
+            }
+            options->task_grain = number;
+        }
+        else if (threads && (value = option_value(argv[i], "numa")))
+        {
+            if (strcmp(value, "off") == 0)
+            {
+                options->numa = false;
+            }
+            else if (strcmp(value, "places") == 0)
+            {
+                options->numa = true;
+            }
+            else
+            {
+                return argv[i];
+            }
+        }
+        else
+        {
+            return argv[i];
+        }
+    }
+
+    return NULL;
+}
+
+void tsp_options_help(bool threads)
+{
+    printf("OPTIONS:\n * --bound=halfsum|1tree: lower bound on the nodes (default halfsum).\n");
+    printf(" * --symmetry=keep|break: search tours in both directions, or in one only (default keep).\n");
+    printf(" * --dominance=MiB: drop nodes beaten by a cheaper path to the same cities, remembering up to MiB of them (default 0, off).\n");
+    printf(" * --endgame=k: solve nodes with at most k cities left in one go, k <= %d (default 0, off).\n", TSP_ENDGAME_MAX);
+    printf(" * --feasibility=off|check: drop nodes whose tour can no longer be closed on a sparse graph (default off).\n");
+    printf(" * --reduce=off|edges: take edges that no good enough tour can use out of the graph before searching (default off).\n");
+    printf(" * --relabel=off|nearest: number the cities along a nearest-neighbour chain while searching; the output is the same (default off).\n");
+    if (!threads)
+    {
+        return;
+    }
+    printf(" * --scheduler=steal|multiqueue|tasks: how nodes are shared between threads, per-thread queues with stealing, a relaxed shared one, or OpenMP tasks searching subtrees depth-first (default steal).\n");
+    printf(" * --task-depth=d: with --scheduler=tasks, search nodes with d cities on their tour (or close to the best tour) as tasks, d >= 2 (default %d).\n", TSP_TASK_DEPTH);
+    printf(" * --task-grain=n: with --scheduler=tasks, a task hands what it has left to new tasks every n nodes, 0 for never (default %d).\n", TSP_TASK_GRAIN);
+    printf(" * --numa=off|places: copy the instance to every OpenMP place and steal within a place first; run with OMP_PLACES=sockets OMP_PROC_BIND=spread (default off).\n");
+}
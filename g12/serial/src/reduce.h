@@ -0,0 +1,19 @@
+/*
+    Edge elimination before the search. An edge is taken out of the graph when even the cheapest
+    tour through it, as far as the half-sum bound or a Lagrangian 1-tree over the whole graph can
+    tell, costs more than the heuristic tour or the limit. On top of that, both edges of a city left
+    with only two are forced, so every other edge at a city with two forced ones goes, and so does
+    an edge that would close a chain of forced edges into a cycle before it takes in every city.
+    The bounds only get tighter as edges go, so this is repeated until nothing more comes out.
+
+    Only tours that could not be printed anyway are lost. tsp and tsp-mpi weigh the tours they find
+    on the graph as it was before (see mirror.h), so when several tie for the cheapest they still
+    report the same one.
+*/
+
+#pragma once
+#include "repr.h"
+
+// Take out of rep every edge that no tour of cost at most limit (or at most seed, what the heuristic
+// tour costs) can use. Returns the half-sum bound at the root of what is left.
+double tsp_reduce(tsp_repr *rep, double limit, double seed);
@@ -0,0 +1,45 @@
+/*
+    The problem instance: the cost matrix plus the per-city data the bound needs.
+*/
+
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct
+{
+    bool valid;
+    unsigned int ncities;
+    double *graph;
+    double *short1;
+    double *short2;
+    // delta[from * ncities + to] is what taking the edge adds to a node's bound (INFINITY if there is no edge)
+    double *delta;
+    // The real edges out of each city, smallest delta first (then lowest city): those of from are at
+    // [adjstart[from], adjstart[from + 1]) in adjcity (where the edge goes) and adjdelta (its delta)
+    unsigned int *adjstart;
+    unsigned int *adjcity;
+    double *adjdelta;
+    // label[city] is the number the input gave city, or NULL when the cities kept their numbers (see relabel.h)
+    unsigned int *label;
+} tsp_repr;
+
+void tsp_delrepr(tsp_repr t);
+
+// Read an instance and precompute its bound deltas and neighbour lists. Closes input.
+tsp_repr tsp_mkrepr(FILE *input);
+
+// Work short1, short2, the deltas and the neighbour lists out again from graph, after edges were
+// taken out of it. Returns false (and complains) if memory ran out.
+bool tsp_repr_refresh(tsp_repr *t);
+
+// A copy of t that shares no memory with it. The calling thread writes every page of it first, so
+// that with threads pinned it sits on their NUMA node. Comes back invalid (with a complaint) if
+// memory ran out.
+tsp_repr tsp_repr_copy(tsp_repr t);
+
+// The number the input gave city
+static inline unsigned int tsp_repr_label(tsp_repr t, unsigned int city)
+{
+    return t.label ? t.label[city] : city;
+}
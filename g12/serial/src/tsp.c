@@ -1,346 +1,352 @@
-#include <math.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <omp.h>
-
-#include "debug.h"
-#include "matrix.h"
-
-#include "lib/nqueue/queue.h"
-
-#define DELTA 4
-
-typedef struct
-{
-    bool valid;
-    unsigned int ncities;
-    double *graph;
-    double *short1;
-    double *short2;
-} tsp_repr;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-    double bound;
-    unsigned int length;
-    unsigned int index;
-} tsp_node;
-
-typedef struct
-{
-    unsigned int *tour;
-    double cost;
-} tsp_result;
-
-void tsp_delrepr(tsp_repr t)
-{
-    if (t.graph)
-    {
-        free(t.graph);
-    }
-    if (t.short1)
-    {
-        free(t.short1);
-    }
-    if (t.short2)
-    {
-        free(t.short2);
-    }
-}
-
-tsp_repr tsp_mkrepr(FILE *input)
-{
-    tsp_repr t;
-    t.graph = NULL;
-    t.short1 = NULL;
-    t.short2 = NULL;
-
-    int nroutes = -1;
-    int from = -1, to = -1;
-    double cost = -1;
-
-    if (fscanf(input, "%u %d", &(t.ncities), &nroutes) == 2)
-    {
-        t.graph = matrix_alloc(t.ncities);
-        t.short1 = array_alloc(t.ncities);
-        t.short2 = array_alloc(t.ncities);
-
-        if (!t.graph || !t.short1 || !t.short2)
-        {
-            error("Failed to allocate memory; aborting!\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    for (int i = 0; i < nroutes; i++)
-    {
-        if (fscanf(input, "%d %d %lf", &from, &to, &cost) == 3)
-        {
-            matrix_write(t.graph, t.ncities, from, to, cost);
-            matrix_write(t.graph, t.ncities, to, from, cost);
-
-            if (t.short1[from] > cost)
-            {
-                t.short2[from] = t.short1[from];
-                t.short1[from] = cost;
-            }
-            else if (t.short2[from] > cost)
-            {
-                t.short2[from] = cost;
-            }
-
-            if (t.short1[to] > cost)
-            {
-                t.short2[to] = t.short1[to];
-                t.short1[to] = cost;
-            }
-            else if (t.short2[to] > cost)
-            {
-                t.short2[to] = cost;
-            }
-        }
-        else
-        {
-            error("Error reading file.\n");
-            t.valid = false;
-            return t;
-        }
-    }
-
-    fclose(input);
-
-    t.valid = true;
-    return t;
-}
-
-tsp_node *tsp_mknode(unsigned int length)
-{
-    tsp_node *node = malloc(sizeof(tsp_node));
-    node->tour = arrayi_alloc(length);
-    return node;
-}
-
-void tsp_delnode(tsp_node *node)
-{
-    if (node->tour)
-    {
-        free(node->tour);
-    }
-
-    free(node);
-}
-
-char tsp_queue_cmp(void *a, void *b)
-{
-    // Lowest lower-bound goes first; if both happen to be tied, the one with the lowest index goes first.
-    if (((tsp_node *)a)->bound == ((tsp_node *)b)->bound)
-    {
-        return (((tsp_node *)a)->index > ((tsp_node *)b)->index);
-    }
-
-    return (((tsp_node *)a)->bound > ((tsp_node *)b)->bound);
-}
-
-tsp_result tsp_exe(tsp_repr rep, double lowerbound, double limit)
-{
-    double *graph = rep.graph;
-    double *short1 = rep.short1;
-    double *short2 = rep.short2;
-    unsigned int ncities = rep.ncities;
-
-    unsigned int *btour = arrayi_alloc(ncities);
-    double btourcost = INFINITY;
-
-    tsp_result result;
-
-    priority_queue_t *queue = queue_create(tsp_queue_cmp);
-    tsp_node *current = tsp_mknode(ncities);
-
-    btour[0] = 0;
-    current->tour[0] = 0;
-    current->cost = 0;
-    current->bound = lowerbound;
-    current->length = 1;
-    current->index = 0;
-
-    queue_push(queue, current);
-
-    while (queue->size)
-    {
-        current = queue_pop(queue);
-
-        if (current->bound >= btourcost)
-        {
-            tsp_delnode(current);
-            break;
-        }
-
-        if (current->length == ncities)
-        {
-            if (current->cost + matrix_read(graph, ncities, current->index, 0) < btourcost)
-            {
-                btourcost = current->cost + matrix_read(graph, ncities, current->index, 0);
-                for (unsigned int i = 0; i < ncities; i++)
-                {
-                    btour[i] = current->tour[i];
-                }
-            }
-        }
-        else
-        {
-            debug("Level: %u\n", current->length);
-            for (unsigned int i = 0; i < ncities; i++)
-            {
-                bool ontour = false;
-                double cost = matrix_read(graph, ncities, current->index, i);
-                if (cost != INFINITY && current->index != i)
-                {
-                    for (unsigned int j = 0; j < current->length; j++)
-                    {
-                        if (current->tour[j] == i)
-                        {
-                            ontour = true;
-                            debug("Visiting node %u\n", current->index);
-                            break;
-                        }
-                    }
-                    if (!ontour)
-                    {
-                        double update = (cost >= short2[i] ? short2[i] : short1[i]) + (cost >= short2[current->index] ? short2[current->index] : short1[current->index]);
-
-                        double newBound = current->bound + cost - (update / 2);
-                        if (newBound > btourcost || newBound > limit)
-                        {
-                            continue;
-                        }
-
-                        tsp_node *new = tsp_mknode(current->length + 1);
-                        for (unsigned int j = 0; j < current->length; j++)
-                        {
-                            new->tour[j] = current->tour[j];
-                        }
-                        new->tour[current->length] = i;
-                        new->cost = current->cost + cost;
-                        new->bound = newBound;
-                        new->length = current->length + 1;
-                        new->index = i;
-                        queue_push(queue, new);
-                    }
-                }
-            }
-        }
-        tsp_delnode(current);
-        debug("Queue size: %lu\n", queue->size);
-    }
-
-    result.tour = btour;
-    result.cost = btourcost;
-
-    while (queue->size > 0)
-    {
-        current = queue_pop(queue);
-        tsp_delnode(current);
-    }
-    queue_delete(queue);
-    free(queue);
-    return result;
-}
-
-void help(char *me)
-{
-    printf("USAGE: %s inputfile lowerbound\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
-}
-
-int main(int argc, char *argv[])
-{
-    double limit = INFINITY;
-    double exec_time;
-
-    // Argument validation
-    if (argc <= 2)
-    {
-        error("No arguments provided.\n");
-        help(argv[0]);
-        return 1;
-    }
-    else if (argc > 3)
-    {
-        error("Too many arguments.\n");
-        help(argv[0]);
-        return 1;
-    }
-
-    // Make sure that the lowerbound arg is a number
-    if (argc != 3 || atof(argv[2]) <= 0)
-    {
-        // Either the value is 0 (not allowed) or it is not a number.
-        // If that's the case ignore this.
-        warn("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
-    }
-    else
-    {
-        limit = (double)atof(argv[2]);
-    }
-    info("Cost must be <= %f\n", limit);
-    info("File target: %s\n", argv[1]);
-    FILE *input = fopen(argv[1], "r");
-    if (!input)
-    {
-        syserr("Could not open the input file");
-        return 1;
-    }
-
-    tsp_repr t = tsp_mkrepr(input);
-    if (!t.valid)
-    {
-        // An earlier error happened preventing us from carrying on
-        tsp_delrepr(t);
-        return 1;
-    }
-
-    double lowerbound = 0;
-    for (size_t i = 0; i < t.ncities; ++i)
-    {
-        lowerbound += t.short1[i] + t.short2[i];
-    }
-    lowerbound /= 2;
-    info("Lowerbound at root = %f\n", lowerbound);
-
-    exec_time = -omp_get_wtime();
-
-    tsp_result result = tsp_exe(t, lowerbound, limit);
-
-    exec_time += omp_get_wtime();
-
-    fprintf(stderr, "%.1fs\n", exec_time);
-    if (lowerbound > limit)
-    {
-        info("Lowerbound %f is higher than the desired limit %f.\n", lowerbound, limit);
-        printf("NO SOLUTION\n");
-    }
-    else if (result.cost > limit)
-    {
-        info("Either the graph is not connected OR the lowerbound limit is too low!\n");
-        printf("NO SOLUTION\n");
-    }
-    else
-    {
-        // Print the tour
-        printf("%.1f\n", result.cost);
-        printf("%d", result.tour[0]);
-        for (size_t i = 1; i < t.ncities; ++i)
-        {
-            printf(" %d", result.tour[i]);
-        }
-        printf(" 0\n");
-    }
-
-    // Cleanup
-    free(result.tour);
-    tsp_delrepr(t);
-    return 0;
-}
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "bound.h"
+#include "debug.h"
+#include "dominance.h"
+#include "endgame.h"
+#include "feasible.h"
+#include "expand.h"
+#include "matrix.h"
+#include "node.h"
+#include "repr.h"
+#include "frontier.h"
+#include "heuristic.h"
+#include "mirror.h"
+#include "options.h"
+#include "reduce.h"
+#include "relabel.h"
+
+#define DELTA 4
+
+typedef struct
+{
+    unsigned int *tour;
+    double cost;
+} tsp_result;
+
+// Search from the heuristic tour btour, of cost seed, which becomes the result's tour. Tours are weighed on
+// whole, the graph before --reduce=edges took edges out of rep, whose root bound is wholebound.
+tsp_result tsp_exe(tsp_repr rep, double lowerbound, tsp_repr whole, double wholebound, double limit, double seed,
+                   unsigned int *btour, tsp_options options)
+{
+    double *graph = rep.graph;
+    unsigned int ncities = rep.ncities;
+
+    // Start from the heuristic tour. Half a cost step above it prunes nearly as hard as the tour itself
+    // would, and still leaves room for the search to find (and report) its own optimal tour.
+    const double upper = seed + TSP_COST_STEP / 2;
+    double btourcost = upper;
+    // With --symmetry=break, --relabel, --endgame, --bound=1tree or --reduce=edges, tours are weighed as the
+    // full search on the input would have: the incumbent as it would see it, and room to turn tours around
+    const bool weigh = options.symmetry || rep.label || options.endgame || options.bound == TSP_BOUND_ONETREE || options.reduce;
+    tsp_mirror_pool *pool = weigh ? tsp_mirror_pool_create(whole, wholebound, upper) : NULL;
+    // Weighing, the search reaches a rounding error past the limit: a tour whose bound lands just over
+    // it one way round may still be under it the other way round
+    const double reach = weigh ? limit + TSP_COST_SLACK(limit) : limit;
+    unsigned int *tour = weigh ? arrayi_alloc(ncities) : NULL;
+
+    tsp_result result;
+
+    // Only set with --bound=1tree; the delta bound then only serves as a quick first cut
+    tsp_bound *onetree = options.bound == TSP_BOUND_ONETREE ? tsp_bound_create(rep) : NULL;
+    // Only set with --dominance
+    tsp_dominance *dominance = options.dominance ? tsp_dominance_create(ncities, options.dominance, options.symmetry) : NULL;
+    // Only set with --endgame
+    tsp_endgame *endgame = options.endgame ? tsp_endgame_create(rep, options.endgame) : NULL;
+    // Only set with --feasibility=check
+    tsp_feasible *feasible = options.feasibility ? tsp_feasible_create(rep) : NULL;
+    unsigned long expanded = 0, infeasible = 0;
+
+    tsp_pool_init(ncities, onetree ? tsp_bound_extra(ncities) : 0);
+    frontier_t *queue = frontier_create();
+    tsp_node *current = tsp_node_root(lowerbound);
+    if (onetree)
+    {
+        current->bound = tsp_bound_root(onetree, current, btourcost < reach ? btourcost : reach);
+        info("1-tree bound at root = %f\n", current->bound);
+    }
+    // Children that survive bounding, as handed out by tsp_expand
+    unsigned int *cities = arrayi_alloc(ncities);
+    double *bounds = array_alloc(ncities);
+
+    btour[0] = 0;
+
+    frontier_push(queue, current);
+
+    while (frontier_size(queue))
+    {
+        current = frontier_pop(queue);
+
+        // Weighing tours, those that tie with the incumbent (give or take rounding) still have to be seen:
+        // one of them may be (the mirror image of) the tour the full search would have reported
+        if (current->bound > btourcost || (!weigh && current->bound >= btourcost))
+        {
+            tsp_delnode(current);
+            break;
+        }
+
+        if (current->length == ncities && weigh)
+        {
+            // Which of the tours that tie is reported is only settled once the search is done
+            tsp_node_tour(current, tour);
+            double cutoff = tsp_mirror_offer(pool, tour, limit);
+            if (cutoff < btourcost)
+            {
+                btourcost = cutoff;
+                frontier_prune(queue, btourcost, true);
+            }
+        }
+        else if (current->length == ncities)
+        {
+            if (current->cost + matrix_read(graph, ncities, current->index, 0) < btourcost)
+            {
+                btourcost = current->cost + matrix_read(graph, ncities, current->index, 0);
+                tsp_node_tour(current, btour);
+                // Nothing left in the queue at or above the new cost can be expanded anymore
+                frontier_prune(queue, btourcost, false);
+            }
+        }
+        else if (dominance && tsp_dominance_stale(dominance, current))
+        {
+            // A cheaper way to the same cities turned up while this node was queued
+        }
+        else if (endgame && tsp_endgame_covers(endgame, current))
+        {
+            // The rest of the tour comes back as complete nodes, which take their turn in the queue like any other
+            double threshold = btourcost < reach ? btourcost : reach;
+            tsp_endgame_solve(endgame, current, onetree ? tsp_bound_halfsum(current) : current->bound, threshold);
+            for (tsp_node *complete; (complete = tsp_endgame_next(endgame));)
+            {
+                frontier_push(queue, complete);
+            }
+        }
+        else
+        {
+            debug("Level: %u\n", current->length);
+            expanded++;
+            double threshold = btourcost < reach ? btourcost : reach;
+            double base = onetree ? tsp_bound_halfsum(current) : current->bound;
+            unsigned int found = tsp_expand_city(&rep, current->index, tsp_node_visited(current), base, threshold, cities, bounds);
+            if (options.symmetry)
+            {
+                found = tsp_mirror_filter(current, ncities, cities, bounds, found);
+            }
+            for (unsigned int k = 0; k < found; k++)
+            {
+                tsp_node *new = tsp_node_child(current, cities[k]);
+                new->cost = current->cost + matrix_read(graph, ncities, current->index, cities[k]);
+                new->bound = bounds[k];
+                if (feasible && !tsp_feasible_child(feasible, current->index, new))
+                {
+                    infeasible++;
+                    tsp_delnode(new);
+                    continue;
+                }
+                if (onetree)
+                {
+                    double bound = tsp_bound_child(onetree, current, new, threshold);
+                    if (bound > threshold)
+                    {
+                        tsp_delnode(new);
+                        continue;
+                    }
+                    new->bound = bound;
+                }
+                if (dominance && tsp_dominance_insert(dominance, new))
+                {
+                    tsp_delnode(new);
+                    continue;
+                }
+                frontier_push(queue, new);
+            }
+        }
+        tsp_delnode(current);
+        debug("Queue size: %lu\n", frontier_size(queue));
+    }
+
+    info("Expanded %lu nodes\n", expanded);
+    if (dominance)
+    {
+        tsp_dominance_stats stats = tsp_dominance_stats_of(dominance);
+        (void)stats; // only read by info()
+        info("Dominance table: %zu slots in %.1f MiB, %lu lookups, %.1f%% hits, %lu pruned\n", stats.slots,
+             stats.bytes / 1048576.0, stats.lookups, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0, stats.pruned);
+        tsp_dominance_delete(dominance);
+    }
+    if (endgame)
+    {
+        tsp_endgame_stats stats = tsp_endgame_stats_of(endgame);
+        (void)stats; // only read by info()
+        info("Endgame: %lu nodes solved, %lu completed, %lu memo lookups, %.1f%% hits\n", stats.solved, stats.completed,
+             stats.lookups, stats.lookups ? 100.0 * stats.hits / stats.lookups : 0.0);
+        tsp_endgame_delete(endgame);
+    }
+    if (feasible)
+    {
+        info("Feasibility: %lu nodes dropped\n", infeasible);
+        tsp_feasible_delete(feasible);
+    }
+    result.tour = btour;
+    // The search only ever beats the seed, so an untouched incumbent means the heuristic tour stands
+    result.cost = btourcost == upper ? seed : btourcost;
+    if (pool)
+    {
+        tsp_mirror_key key = tsp_mirror_pick(pool, btour);
+        result.cost = key.cost == INFINITY ? seed : key.cost;
+        tsp_mirror_pool_delete(pool);
+    }
+
+    while (frontier_size(queue) > 0)
+    {
+        current = frontier_pop(queue);
+        tsp_delnode(current);
+    }
+    frontier_delete(queue);
+    tsp_pool_release();
+    if (onetree)
+    {
+        tsp_bound_delete(onetree);
+    }
+    free(tour);
+    free(cities);
+    free(bounds);
+    return result;
+}
+
+void help(char *me)
+{
+    printf("USAGE: %s inputfile lowerbound [options]\n * Where inputfile is a file;\n * Where lowerbound is a number.\n", me);
+    tsp_options_help(false);
+}
+
+int main(int argc, char *argv[])
+{
+    double limit = INFINITY;
+    double exec_time;
+    tsp_options options;
+    const char *bad;
+
+    // Argument validation
+    if (argc <= 2)
+    {
+        error("No arguments provided.\n");
+        help(argv[0]);
+        return 1;
+    }
+    else if ((bad = tsp_options_parse(&options, argc, argv, 3, false)))
+    {
+        error("Unknown option: %s\n", bad);
+        help(argv[0]);
+        return 1;
+    }
+
+    // Make sure that the lowerbound arg is a number
+    if (atof(argv[2]) <= 0)
+    {
+        // Either the value is 0 (not allowed) or it is not a number.
+        // If that's the case ignore this.
+        warn("The lowerbound argument doesn't seem to be a positive number. Ignoring.\n");
+    }
+    else
+    {
+        limit = (double)atof(argv[2]);
+    }
+    info("Cost must be <= %f\n", limit);
+    info("File target: %s\n", argv[1]);
+    FILE *input = fopen(argv[1], "r");
+    if (!input)
+    {
+        syserr("Could not open the input file");
+        return 1;
+    }
+
+    tsp_repr t = tsp_mkrepr(input);
+    if (!t.valid)
+    {
+        // An earlier error happened preventing us from carrying on
+        tsp_delrepr(t);
+        return 1;
+    }
+
+    double lowerbound = 0;
+    for (size_t i = 0; i < t.ncities; ++i)
+    {
+        lowerbound += t.short1[i] + t.short2[i];
+    }
+    lowerbound /= 2;
+    info("Lowerbound at root = %f\n", lowerbound);
+
+    exec_time = -omp_get_wtime();
+
+    tsp_expand_init();
+    // One heuristic tour serves both the edge elimination and the search
+    unsigned int *btour = arrayi_alloc(t.ncities);
+    double start = omp_get_wtime();
+    double seed = tsp_heuristic(t, btour);
+    (void)start; // only read by info()
+    info("Heuristic tour: %.1f in %.3fs\n", seed, omp_get_wtime() - start);
+    // lowerbound stays as summed in the input's order, which the search on renumbered cities has to match
+    if (options.relabel && !tsp_relabel(&t, btour))
+    {
+        free(btour);
+        tsp_delrepr(t);
+        return 1;
+    }
+    // Tours are still weighed on every edge the input has
+    tsp_repr whole = t;
+    double wholebound = lowerbound;
+    if (options.reduce)
+    {
+        whole = tsp_repr_copy(t);
+        if (!whole.valid)
+        {
+            free(btour);
+            tsp_delrepr(whole);
+            tsp_delrepr(t);
+            return 1;
+        }
+        lowerbound = tsp_reduce(&t, limit, seed);
+    }
+    tsp_result result = tsp_exe(t, lowerbound, whole, wholebound, limit, seed, btour, options);
+    tsp_relabel_tour(t, result.tour);
+
+    exec_time += omp_get_wtime();
+
+    fprintf(stderr, "%.1fs\n", exec_time);
+    // The reduced graph's bound can come out a rounding error over a tour right on the limit
+    if (wholebound > limit)
+    {
+        info("Lowerbound %f is higher than the desired limit %f.\n", wholebound, limit);
+        printf("NO SOLUTION\n");
+    }
+    else if (result.cost > limit)
+    {
+        info("Either the graph is not connected OR the lowerbound limit is too low!\n");
+        printf("NO SOLUTION\n");
+    }
+    else
+    {
+        // Print the tour
+        printf("%.1f\n", result.cost);
+        printf("%d", result.tour[0]);
+        for (size_t i = 1; i < t.ncities; ++i)
+        {
+            printf(" %d", result.tour[i]);
+        }
+        printf(" 0\n");
+    }
+
+    // Cleanup
+    free(result.tour);
+    if (options.reduce)
+    {
+        tsp_delrepr(whole);
+    }
+    tsp_delrepr(t);
+    return 0;
+}